@@ -1,7 +1,7 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <string.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -33,6 +33,11 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable receive and transmit FIFOs. */
+#define FCR_CLEAR 0x06          /* Clear both FIFOs. */
+#define FIFO_SIZE 16            /* Bytes in the 16550A transmit FIFO. */
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -51,14 +56,51 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Data to be transmitted, as a ring buffer.  Filled by
+   serial_putc() and serial_putbuf(), drained by the interrupt
+   handler a FIFO's worth at a time.  HEAD and TAIL run freely;
+   HEAD - TAIL is the number of bytes queued. */
+#define TXQ_SIZE 4096           /* Power of 2. */
+static uint8_t txq[TXQ_SIZE];
+static unsigned txq_head, txq_tail;
+
+/* A thread waiting for room in txq, if any, and a lock that
+   lets only one thread at a time wait. */
+static struct thread *txq_waiter;
+static struct lock txq_lock;
+
+/* Last value written to IER_REG.  Port writes are slow, above
+   all under emulation, so IER_REG is written only on change. */
+static uint8_t ier;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
 static void write_ier (void);
+static void txq_make_room (enum intr_level);
 static intr_handler_func serial_interrupt;
 
+/* Returns true if the transmit queue is empty. */
+static inline bool
+txq_empty (void) 
+{
+  return txq_head == txq_tail;
+}
+
+/* Returns true if the transmit queue is full. */
+static inline bool
+txq_full (void) 
+{
+  return txq_head - txq_tail == TXQ_SIZE;
+}
+
+/* Removes and returns the oldest byte in the transmit queue,
+   which must not be empty. */
+static inline uint8_t
+txq_getc (void) 
+{
+  return txq[txq_tail++ % TXQ_SIZE];
+}
+
 /* Initializes the serial port device for polling mode.
    Polling mode busy-waits for the serial port to become free
    before writing to it.  It's slow, but until interrupts have
@@ -68,10 +110,11 @@ init_poll (void)
 {
   ASSERT (mode == UNINIT);
   outb (IER_REG, 0);                    /* Turn off all interrupts. */
+  ier = 0;
   outb (FCR_REG, 0);                    /* Disable FIFO. */
   set_serial (9600);                    /* 9.6 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
+  lock_init (&txq_lock);
   mode = POLL;
 } 
 
@@ -88,6 +131,7 @@ serial_init_queue (void)
   ASSERT (mode == POLL);
 
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR);
   mode = QUEUE;
   old_level = intr_disable ();
   write_ier ();
@@ -112,20 +156,61 @@ serial_putc (uint8_t byte)
     {
       /* Otherwise, queue a byte and update the interrupt enable
          register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      if (txq_full ())
+        txq_make_room (old_level);
+      txq[txq_head++ % TXQ_SIZE] = byte;
+      write_ier ();
+    }
+  
+  intr_set_level (old_level);
+}
+
+/* Sends the SIZE bytes in BUFFER to the serial port.  In queued
+   mode this copies as much of BUFFER into the transmit queue as
+   fits at a time and returns as soon as the last byte has been
+   queued, updating the interrupt enable register only once per
+   batch. */
+void
+serial_putbuf (const uint8_t *buffer, size_t size) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (mode != QUEUE)
+    {
+      if (mode == UNINIT)
+        init_poll ();
+      while (size-- > 0)
+        putc_poll (*buffer++);
+    }
+  else
+    {
+      while (size > 0)
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          size_t head_ofs = txq_head % TXQ_SIZE;
+          size_t room = TXQ_SIZE - (txq_head - txq_tail);
+          size_t chunk;
+
+          if (room == 0)
+            {
+              txq_make_room (old_level);
+              continue;
+            }
+
+          /* Copy up to the end of the free space or of the
+             buffer array, whichever comes first. */
+          chunk = size;
+          if (chunk > room)
+            chunk = room;
+          if (chunk > TXQ_SIZE - head_ofs)
+            chunk = TXQ_SIZE - head_ofs;
+          memcpy (txq + head_ofs, buffer, chunk);
+          txq_head += chunk;
+          buffer += chunk;
+          size -= chunk;
         }
-
-      intq_putc (&txq, byte); 
       write_ier ();
     }
-  
+
   intr_set_level (old_level);
 }
 
@@ -135,8 +220,8 @@ void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
-  while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+  while (!txq_empty ())
+    putc_poll (txq_getc ());
   intr_set_level (old_level);
 }
 
@@ -172,25 +257,58 @@ set_serial (int bps)
   outb (LCR_REG, LCR_N81);
 }
 
+/* Waits for room in the full transmit queue.  OLD_LEVEL is the
+   interrupt level of the caller, who has since turned interrupts
+   off. */
+static void
+txq_make_room (enum intr_level old_level) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (old_level == INTR_OFF || intr_context ())
+    {
+      /* Interrupts are off and the transmit queue is full.
+         If we wanted to wait for the queue to empty,
+         we'd have to reenable interrupts.
+         That's impolite, so we'll send a character via
+         polling instead. */
+      putc_poll (txq_getc ()); 
+      return;
+    }
+
+  write_ier ();
+  lock_acquire (&txq_lock);
+  while (txq_full ())
+    {
+      txq_waiter = thread_current ();
+      thread_block ();
+    }
+  lock_release (&txq_lock);
+}
+
 /* Update interrupt enable register. */
 static void
 write_ier (void) 
 {
-  uint8_t ier = 0;
+  uint8_t new_ier = 0;
 
   ASSERT (intr_get_level () == INTR_OFF);
 
   /* Enable transmit interrupt if we have any characters to
      transmit. */
-  if (!intq_empty (&txq))
-    ier |= IER_XMIT;
+  if (!txq_empty ())
+    new_ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
      characters we receive. */
   if (!input_full ())
-    ier |= IER_RECV;
+    new_ier |= IER_RECV;
   
-  outb (IER_REG, ier);
+  if (new_ier != ier)
+    {
+      outb (IER_REG, new_ier);
+      ier = new_ier;
+    }
 }
 
 /* Polls the serial port until it's ready,
@@ -218,10 +336,20 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* If the transmitter is empty, fill its FIFO from the queue
+     without polling the status register for every byte. */
+  if (!txq_empty () && (inb (LSR_REG) & LSR_THRE) != 0) 
+    {
+      int i;
+
+      for (i = 0; i < FIFO_SIZE && !txq_empty (); i++)
+        outb (THR_REG, txq_getc ());
+      if (txq_waiter != NULL)
+        {
+          thread_unblock (txq_waiter);
+          txq_waiter = NULL;
+        }
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
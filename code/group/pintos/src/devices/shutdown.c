@@ -5,13 +5,17 @@
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
 #ifdef USERPROG
 #include "userprog/exception.h"
 #endif
 #ifdef FILESYS
 #include "devices/block.h"
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
+#include "filesys/journal.h"
 #endif
 
 /* Keyboard control register port. */
@@ -123,8 +127,12 @@ print_stats (void)
 {
   timer_print_stats ();
   thread_print_stats ();
+  kmem_print_stats ();
+  palloc_print_stats ();
 #ifdef FILESYS
   block_print_stats ();
+  cache_print_stats ();
+  journal_print_stats ();
 #endif
   console_print_stats ();
   kbd_print_stats ();
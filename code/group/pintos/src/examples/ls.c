@@ -6,7 +6,10 @@
 
    By default, only the name of each file is printed.  If "-l" is
    given as the first argument, the type, size, and inumber of
-   each file is also printed.  This won't work until project 4. */
+   each file is also printed.  This won't work until project 4.
+
+   Entries are read with readdir_batch(), many per system call,
+   and sizes with stat(), without opening each file. */
 
 #include <syscall.h>
 #include <stdio.h>
@@ -24,38 +27,43 @@ list_dir (const char *dir, bool verbose)
 
   if (isdir (dir_fd))
     {
-      char name[READDIR_MAX_LEN];
+      struct dirent ents[32];
+      int cnt;
 
       printf ("%s", dir);
       if (verbose)
         printf (" (inumber %d)", inumber (dir_fd));
       printf (":\n");
 
-      while (readdir (dir_fd, name)) 
+      while ((cnt = readdir_batch (dir_fd, ents, sizeof ents)) > 0) 
         {
-          printf ("%s", name); 
-          if (verbose) 
-            {
-              char full_name[128];
-              int entry_fd;
+          int i;
 
-              snprintf (full_name, sizeof full_name, "%s/%s", dir, name);
-              entry_fd = open (full_name);
+          for (i = 0; i < cnt; i++)
+            {
+              const struct dirent *e = &ents[i];
 
-              printf (": ");
-              if (entry_fd != -1)
+              printf ("%s", e->name); 
+              if (verbose && e->is_dir)
+                printf (": directory, inumber %d", (int) e->inumber);
+              else if (verbose) 
                 {
-                  if (isdir (entry_fd))
-                    printf ("directory");
+                  char full_name[128];
+                  struct stat st;
+
+                  snprintf (full_name, sizeof full_name, "%s/%s",
+                            dir, e->name);
+
+                  printf (": ");
+                  if (stat (full_name, &st))
+                    printf ("%d-byte file, %u blocks", (int) st.length,
+                            (unsigned) st.blocks);
                   else
-                    printf ("%d-byte file", filesize (entry_fd));
-                  printf (", inumber %d", inumber (entry_fd));
+                    printf ("stat failed");
+                  printf (", inumber %d", (int) e->inumber);
                 }
-              else
-                printf ("open failed");
-              close (entry_fd);
+              printf ("\n");
             }
-          printf ("\n");
         }
     }
   else 
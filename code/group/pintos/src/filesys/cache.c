@@ -1,12 +1,33 @@
 #include "filesys/cache.h"
+#include <debug.h>
+#include <hash.h>
+#include <inttypes.h>
+#include <round.h>
+#include <stdio.h>
 #include "devices/block.h"
+#include "filesys/journal.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
 
 
-#define  MAX_NUM_ENTRIES 64
 #define  N_CHANCE				 5
 
+/* Sectors of cached data that fit in one page. */
+#define ENTRIES_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Number of entries unless -cache says otherwise, and the fewest
+   allowed: the journal may pin JOURNAL_SECTORS - 1 entries, and
+   eviction needs some left over. */
+#define DEFAULT_NUM_ENTRIES 64
+#define MIN_NUM_ENTRIES ROUND_UP (JOURNAL_SECTORS + 8, ENTRIES_PER_PAGE)
+
+/* Most entries cache_flush_owner() sorts at once. */
+#define FLUSH_BATCH 64
+
 /* construct array */
-static struct cache_entry *cache[MAX_NUM_ENTRIES];
+static struct cache_entry *cache;
+static size_t num_entries = DEFAULT_NUM_ENTRIES;
 bool is_cache_init = false;
 
 /* student testing-1 */
@@ -16,22 +37,126 @@ int cache_hit_cnt = 0;
 struct lock entry_lock;
 struct lock clock_lock;
 
-/* Initializes cache array with 64 cache entries. Each cache
-   entry is initiaized with default values. */
+/* Index of the cached sectors, so that looking one up does not
+   scan every entry, and the lock that protects it.  Holds at
+   most one entry per sector. */
+static struct hash index;
+static struct lock index_lock;
+
+/* Where the clock algorithm's hand points. */
+static size_t clock_hand;
+
+static hash_hash_func entry_hash;
+static hash_less_func entry_less;
+static struct cache_entry *index_get (struct block *, block_sector_t);
+static void cache_put (struct cache_entry *);
+
+/* Cache statistics of one file.  Kept until shutdown, even after
+   the file is closed, so that cache_print_stats() can list it,
+   but cleared when the file is deleted and its inode freed.
+   An open inode holds a pointer to its counts, so accesses update
+   them without looking them up. */
+struct file_stat
+  {
+    struct hash_elem elem;              /* Element in file_stats. */
+    block_sector_t owner;               /* Sector of the file's inode. */
+    struct cache_stat stat;             /* Counts for its data. */
+  };
+
+/* Statistics of every file that has been opened, and the lock
+   that protects the table, but not the counts. */
+static struct hash file_stats;
+static struct lock file_stats_lock;
+
+/* -cache-top: Number of files to list at shutdown. */
+static int top_cnt;
+
+static hash_hash_func file_stat_hash;
+static hash_less_func file_stat_less;
+static void print_top_files (void);
+
+/* Adds one to counter FIELD of struct cache_stat for the running
+   thread and in STAT, a file's counts, if it is not null. */
+#define COUNT(STAT, FIELD)                                      \
+  do                                                            \
+    {                                                           \
+      struct cache_stat *stat_ = (STAT);                        \
+      thread_current ()->cache_stat.FIELD++;                    \
+      if (stat_ != NULL)                                        \
+        stat_->FIELD++;                                         \
+    }                                                           \
+  while (0)
+
+/* Sets the number of sectors the cache holds to CNT, rounded up
+   to a whole number of pages, as given by the -cache option.
+   Must be called before the cache is first used. */
+void
+cache_configure (int cnt)
+{
+  ASSERT (!is_cache_init);
+
+  if (cnt < MIN_NUM_ENTRIES)
+    PANIC ("-cache=%d is below the minimum of %d sectors",
+           cnt, MIN_NUM_ENTRIES);
+  num_entries = ROUND_UP (cnt, ENTRIES_PER_PAGE);
+}
+
+/* Makes cache_print_stats() list the CNT files with the most
+   misses, as given by the -cache-top option. */
+void
+cache_configure_top (int cnt)
+{
+  top_cnt = cnt;
+}
+
+/* Initializes cache array with num_entries cache entries. Each
+   cache entry is initiaized with default values.  The entries'
+   data is carved from whole pages, ENTRIES_PER_PAGE sectors to a
+   page, rather than each sector taking a 1 kB malloc() block.
+   If the kernel pool runs out first, the cache is smaller. */
 void
 cache_init ()
 {
-  int i;
+  size_t i;
+
+  cache = malloc (num_entries * sizeof *cache);
+  if (cache == NULL)
+    PANIC ("cannot allocate %zu cache entries", num_entries);
+
   /* construct entry and add to each index of array. Init each entry. */
-	for (i = 0; i < MAX_NUM_ENTRIES; i++) {
-		cache[i] = (struct cache_entry *) malloc (sizeof (struct cache_entry));
-		cache_entry_init (cache[i]);
-    cache[i]->ref_count = 0;
-	}
+  for (i = 0; i < num_entries; i++)
+    {
+      if (i % ENTRIES_PER_PAGE == 0)
+        {
+          uint8_t *page = palloc_get_page (0);
+          if (page == NULL)
+            break;
+          cache[i].data = page;
+        }
+      else
+        cache[i].data = cache[i - 1].data + BLOCK_SECTOR_SIZE;
+      cache_entry_init (&cache[i]);
+      cache[i].ref_count = 0;
+    }
+  if (i < num_entries)
+    {
+      if (i < MIN_NUM_ENTRIES)
+        PANIC ("out of memory for the buffer cache");
+      printf ("cache: only %zu of %zu sectors fit in memory\n",
+              i, num_entries);
+      num_entries = i;
+    }
+
   /* Lock for the rotating hand of the clock algorithm */
   lock_init (&entry_lock);
   /* Lock for the rotating hand of the clock algorithm */
   lock_init (&clock_lock);
+
+  hash_init (&index, entry_hash, entry_less, NULL);
+  lock_init (&index_lock);
+
+  hash_init (&file_stats, file_stat_hash, file_stat_less, NULL);
+  lock_init (&file_stats_lock);
 }
 
 /* Initializes a cache entry with default values for all of its fields.
@@ -41,9 +166,13 @@ cache_entry_init (struct cache_entry *entry)
 {
 	entry->accessed = false;
 	entry->modified = false;
+  entry->logged = false;
 
   entry->block = NULL;
   entry->sector = 4294967295;
+  entry->owner = CACHE_NO_OWNER;
+  entry->stat = NULL;
+  entry->indexed = false;
 
 	entry->n_chance = 0;
 
@@ -54,64 +183,123 @@ cache_entry_init (struct cache_entry *entry)
 /* Called when the cache is full, and there is a call to read_data that needs an empty
    cache entry. get_cache_entry () determines which entry in the cache should 
    be evicted based on a Clock Algorithm with Nth Chance. The function returns a pointer 
-   to the cache entry that should be evicted. */
+   to the cache entry that should be evicted.  The hand stays where
+   it stopped, so the next call goes on from there instead of
+   sweeping the entries it just passed over again. */
 struct cache_entry *
 get_cache_entry ()
 {
-  int i;
   struct cache_entry *entry;
 
   lock_acquire (&clock_lock);
   
   while (true)
     {
-      for (i = 0; i < MAX_NUM_ENTRIES; i++)
+      entry = &cache[clock_hand];
+      clock_hand = (clock_hand + 1) % num_entries;
+
+      /* Recently Accessed */
+      if (entry->accessed == true)
+        /* Set to not (i.e. no longer) recently accessed */
+        entry->accessed = false;
+      /* Not recently accessed */
+      else
         {
-          entry = cache[i];
-          /* Recently Accessed */
-          if (entry->accessed == true)
-            /* Set to not (i.e. no longer) recently accessed */
-            entry->accessed = false;
-          /* Not recently accessed */
-          else
+          /* Logged entries may not reach their home sector
+             before their journal group commits. */
+          if (entry->ref_count == 0 && !entry->logged)
             {
-              if (entry->ref_count == 0)
+              entry->n_chance++;
+              if (entry->n_chance == N_CHANCE)
                 {
-                  entry->n_chance++;
-                  if (entry->n_chance == N_CHANCE)
-                    {
-                      lock_release (&clock_lock);
-                      return entry;
-                    }
+                  lock_release (&clock_lock);
+                  return entry;
                 }
             }
         }
     }
 }
 
-/* Takes in a block sector number, loops through the cache, and returns the
+/* Takes in a block sector number, looks it up in the index, and returns the
    cache entry that corresponds to the block sector number. If the block is
    not in cache, returns NULL. */
 struct cache_entry *
 find_block_in_cache (struct block *block, block_sector_t sector)
 {
-  struct cache_entry *entry;
-  int i;
-  for (i = 0; i < MAX_NUM_ENTRIES; i++)
-    {
-      entry = cache[i];
-      if (entry->block == block && entry->sector == sector)
-        return entry;
-    }
-  return NULL;
+  struct cache_entry key;
+  struct hash_elem *e;
+
+  if (!is_cache_init)
+    return NULL;
+
+  key.block = block;
+  key.sector = sector;
+  lock_acquire (&index_lock);
+  e = hash_find (&index, &key.index_elem);
+  lock_release (&index_lock);
+  return e != NULL ? hash_entry (e, struct cache_entry, index_elem) : NULL;
 }
 
-/* First checks if data is in cache. If it is, copy data from
-   cache to buffer. If it isn't, find an entry to evict in cache
-	 and if the entry is dirty, we write back to disk from cache to disk.
-	 Then, copy the data from cache to buffer. */
-void
-cache_read (struct block *block, block_sector_t sector, void *buffer)
+/* Looks SECTOR of BLOCK up in the index and, if it is cached,
+   increments its entry's ref_count before the entry can leave the
+   index.  Returns the entry, or a null pointer if the sector is
+   not cached.  The caller must hold index_lock. */
+static struct cache_entry *
+index_get (struct block *block, block_sector_t sector)
+{
+  struct cache_entry key, *entry;
+  struct hash_elem *e;
+
+  ASSERT (lock_held_by_current_thread (&index_lock));
+
+  key.block = block;
+  key.sector = sector;
+  e = hash_find (&index, &key.index_elem);
+  if (e == NULL)
+    return NULL;
+
+  entry = hash_entry (e, struct cache_entry, index_elem);
+  lock_acquire (&entry_lock);
+  entry->ref_count++;
+  lock_release (&entry_lock);
+  return entry;
+}
+
+/* Returns a hash of the sector that entry E holds. */
+static unsigned
+entry_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  const struct cache_entry *entry
+    = hash_entry (e, struct cache_entry, index_elem);
+
+  return (hash_bytes (&entry->block, sizeof entry->block)
+          ^ hash_int (entry->sector));
+}
+
+/* Returns true if the sector that entry A holds precedes B's. */
+static bool
+entry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct cache_entry *a = hash_entry (a_, struct cache_entry, index_elem);
+  const struct cache_entry *b = hash_entry (b_, struct cache_entry, index_elem);
+
+  if (a->block != b->block)
+    return a->block < b->block;
+  return a->sector < b->sector;
+}
+
+/* Returns the cache entry holding SECTOR of BLOCK for reading.
+   If the sector is not cached, find an entry to evict in cache
+   and if the entry is dirty, we write back to disk from cache to
+   disk, then read the sector in, unless FILL is false because
+   the caller will overwrite all of it.  The entry's ref_count is
+   incremented so it cannot be evicted until the caller passes it
+   to cache_put().  A read that fills the entry is counted in
+   STAT, the counts of the file whose inode is in sector OWNER. */
+static struct cache_entry *
+cache_get (struct block *block, block_sector_t sector, bool fill,
+           block_sector_t owner, struct cache_stat *stat)
 {
   /* initialize cache list */
   if (!is_cache_init) 
@@ -122,74 +310,134 @@ cache_read (struct block *block, block_sector_t sector, void *buffer)
 
   /* increment cache_read_count */
   cache_read_cnt++;
+  if (fill)
+    COUNT (stat, reads);
 
   /* check if it's in cache */
-  struct cache_entry *entry = find_block_in_cache (block, sector);
-
-  /* found in cache */
-	if (entry != NULL) 
-    {
-      cache_hit_cnt++;
-
-      /* increment ref_count */
-      lock_acquire (&entry_lock);
-      entry->ref_count++;
-      lock_release (&entry_lock);
-
-  		/* copy from cache to buffer */
-  		memcpy (buffer, entry->data, BLOCK_SECTOR_SIZE);
-
-      /* update fields */
-  		entry->accessed = true;
-  		entry->read_cnt++;
+  bool miss = false;
+  lock_acquire (&index_lock);
+  struct cache_entry *entry = index_get (block, sector);
+  lock_release (&index_lock);
 
-      /* decrement ref_count */
-      lock_acquire (&entry_lock);
-      entry->ref_count--;
-      lock_release (&entry_lock);
-  	} 
   /* not in cache */
-  else
+  if (entry == NULL)
     {
+      struct cache_entry *victim;
+
   		/* find entry to evict */
-  		entry = get_cache_entry ();
+  		victim = get_cache_entry ();
 
       /* increment ref_count */
       lock_acquire (&entry_lock);
-      entry->ref_count++;
+      victim->ref_count++;
       lock_release (&entry_lock);
 
+      if (victim->block != NULL)
+        COUNT (victim->stat, evictions);
+
   		/* if dirty */
-  		if (entry->modified)
-  			/* write back */
-  			block_write (entry->block, entry->sector, entry->data);
+  		if (victim->modified)
+        {
+          /* write back */
+          block_write (victim->block, victim->sector, victim->data);
+          COUNT (victim->stat, write_backs);
+        }
+
+      /* Take the victim out of the index and, unless another
+         thread cached SECTOR while we evicted, put it back in
+         for SECTOR, in one step, so that the index never holds
+         two entries for a sector.  If another thread won, use its
+         entry and leave the victim free. */
+      lock_acquire (&index_lock);
+      if (victim->indexed)
+        hash_delete (&index, &victim->index_elem);
 
   		/* reset all fields (except ref_count) */
-  		cache_entry_init (entry);
+  		cache_entry_init (victim);
+      entry = index_get (block, sector);
+      if (entry == NULL)
+        {
+          entry = victim;
+          entry->block = block;
+          entry->sector = sector;
+          entry->owner = owner;
+          entry->stat = stat;
+          hash_insert (&index, &entry->index_elem);
+          entry->indexed = true;
+        }
+      lock_release (&index_lock);
 
-      /* update fields */
-      entry->accessed = true;
-      entry->read_cnt++;
-      entry->block = block;
-      entry->sector = sector;
+      if (entry == victim)
+        {
+          /* read from disk to cache */
+          miss = true;
+          if (fill)
+            block_read (block, sector, entry->data);
+        }
+      else
+        cache_put (victim);
+  	}
 
-  		/* read from disk to cache */
-  		block_read (block, sector, entry->data);
+  /* found in cache */
+  if (!miss)
+    {
+      cache_hit_cnt++;
+      if (fill)
+        COUNT (stat, hits);
+    }
 
-      /* read from disk to thread */
-      memcpy (buffer, entry->data, BLOCK_SECTOR_SIZE);
+  /* update fields */
+  entry->accessed = true;
+  entry->read_cnt++;
+  return entry;
+}
 
-      /* decrement ref_count */
-      lock_acquire (&entry_lock);
-      entry->ref_count--;
-      lock_release (&entry_lock);
-  	}
+/* Releases ENTRY, obtained from cache_get(). */
+static void
+cache_put (struct cache_entry *entry)
+{
+  /* decrement ref_count */
+  lock_acquire (&entry_lock);
+  entry->ref_count--;
+  lock_release (&entry_lock);
+}
+
+/* Copies SECTOR of BLOCK into BUFFER through the cache. */
+void
+cache_read (struct block *block, block_sector_t sector, void *buffer)
+{
+  cache_read_owned (block, sector, buffer, CACHE_NO_OWNER, NULL);
+}
+
+/* Like cache_read(), but counts the read in STAT, the counts of
+   the file whose inode is in sector OWNER. */
+void
+cache_read_owned (struct block *block, block_sector_t sector, void *buffer,
+                  block_sector_t owner, struct cache_stat *stat)
+{
+  struct cache_entry *entry = cache_get (block, sector, true, owner, stat);
+
+  /* copy from cache to buffer */
+  memcpy (buffer, entry->data, BLOCK_SECTOR_SIZE);
+  cache_put (entry);
 }
 
 /* First checks if data is in cache. If it isn't, write data
    directly to disk. If it is, write data to cache. */
 void
 cache_write (struct block *block, block_sector_t sector, const void *buffer)
+{
+  cache_write_owned (block, sector, buffer, CACHE_NO_OWNER, NULL);
+}
+
+/* Like cache_write(), but records that the sector holds data of
+   the file whose inode is in sector OWNER, so that
+   cache_flush_owner() can find it if it stays dirty in the
+   cache, and counts the write in STAT, the file's counts. */
+void
+cache_write_owned (struct block *block, block_sector_t sector,
+                   const void *buffer, block_sector_t owner,
+                   struct cache_stat *stat)
 {
   /* initialize cache list */
   if (!is_cache_init) 
@@ -198,22 +446,23 @@ cache_write (struct block *block, block_sector_t sector, const void *buffer)
       is_cache_init = true;
     } 
 
-  /* check if it's in cache */
-  struct cache_entry *entry = find_block_in_cache (block, sector);
+  /* check if it's in cache, and if so increment ref_count (no
+     eviction allowed while ref_count is non-zero) */
+  lock_acquire (&index_lock);
+  struct cache_entry *entry = index_get (block, sector);
+  lock_release (&index_lock);
 
+  COUNT (stat, writes);
   if (entry != NULL)  /* found in cache */
     {
-      /* increment ref_count (no eviction allowed while ref_count is non-zero) */
-      lock_acquire (&entry_lock);
-      entry->ref_count++;
-      lock_release (&entry_lock);
-
       /* Write (copy) buffer data into cache entry, and update fields. */
       memcpy (entry->data, buffer, BLOCK_SECTOR_SIZE);
 
       /* update fields */
       entry->accessed = true;
       entry->modified = true;
+      entry->owner = owner;
+      entry->stat = stat;
       entry->write_cnt++;
 
       /* decrement ref_count */
@@ -224,8 +473,310 @@ cache_write (struct block *block, block_sector_t sector, const void *buffer)
 
   /* not in cache */
   else
-    /* Write buffer data to directly to disk. */
-    block_write (block, sector, buffer);
+    {
+      /* Write buffer data to directly to disk. */
+      block_write (block, sector, buffer);
+      COUNT (stat, write_backs);
+    }
+}
+
+/* Copies sector SRC of BLOCK to sector DST, which holds data of
+   the file whose inode is in sector OWNER and whose counts are
+   STAT, through the cache.
+   SRC's data goes from its cache entry straight into DST's entry,
+   or straight to disk if DST is not cached, so the sector is
+   copied once instead of through a caller's buffer. */
+void
+cache_copy (struct block *block, block_sector_t dst, block_sector_t src,
+            block_sector_t owner, struct cache_stat *stat)
+{
+  struct cache_entry *entry;
+
+  entry = cache_get (block, src, true, CACHE_NO_OWNER, NULL);
+
+  cache_write_owned (block, dst, entry->data, owner, stat);
+  cache_put (entry);
+}
+
+/* Fills SECTOR of BLOCK, which holds data of the file whose
+   inode is in sector OWNER and whose counts are STAT, with zeros
+   in the cache, without
+   reading or writing the disk.  The zeros reach disk when the
+   entry is written back, unless data is written over them
+   first. */
+void
+cache_zero (struct block *block, block_sector_t sector, block_sector_t owner,
+            struct cache_stat *stat)
+{
+  struct cache_entry *entry = cache_get (block, sector, false, owner, stat);
+
+  memset (entry->data, 0, BLOCK_SECTOR_SIZE);
+  entry->modified = true;
+  entry->owner = owner;
+  entry->stat = stat;
+  entry->write_cnt++;
+  COUNT (stat, writes);
+  cache_put (entry);
+}
+
+/* Copies BUFFER into the cache entry for SECTOR of BLOCK as part
+   of the running journal group.  Unlike cache_write(), the
+   sector is always brought into the cache, and the entry is
+   pinned there, so that it is neither evicted nor written to its
+   home sector until cache_checkpoint().  Sets *NEWLY_LOGGED to
+   true if the entry was not already logged.  Returns the entry.
+
+   The caller must keep fewer entries logged than the cache
+   holds, or eviction would find nothing to evict. */
+struct cache_entry *
+cache_log (struct block *block, block_sector_t sector, const void *buffer,
+           bool *newly_logged)
+{
+  struct cache_entry *entry;
+
+  entry = cache_get (block, sector, true, CACHE_NO_OWNER, NULL);
+  memcpy (entry->data, buffer, BLOCK_SECTOR_SIZE);
+  entry->modified = true;
+  entry->owner = CACHE_NO_OWNER;
+  entry->stat = NULL;
+  entry->write_cnt++;
+  COUNT (NULL, writes);
+  *newly_logged = !entry->logged;
+  entry->logged = true;
+  cache_put (entry);
+  return entry;
+}
+
+/* Writes logged ENTRY to its home sector, now that its journal
+   group has committed, and unpins it. */
+void
+cache_checkpoint (struct cache_entry *entry)
+{
+  ASSERT (entry->logged);
+
+  block_write (entry->block, entry->sector, entry->data);
+  COUNT (entry->stat, write_backs);
+  entry->modified = false;
+  entry->logged = false;
+}
+
+/* Writes every dirty entry that is not logged back to disk. */
+void
+cache_flush (void)
+{
+  size_t i;
+
+  if (!is_cache_init)
+    return;
+  for (i = 0; i < num_entries; i++)
+    {
+      struct cache_entry *entry = &cache[i];
+      if (entry->modified && !entry->logged)
+        {
+          block_write (entry->block, entry->sector, entry->data);
+          COUNT (entry->stat, write_backs);
+          entry->modified = false;
+        }
+    }
+}
+
+/* Writes SECTOR of BLOCK back to disk if it is cached, dirty
+   and not logged, leaving it in the cache. */
+void
+cache_write_back (struct block *block, block_sector_t sector)
+{
+  struct cache_entry *entry;
+
+  if (!is_cache_init)
+    return;
+
+  lock_acquire (&index_lock);
+  entry = index_get (block, sector);
+  lock_release (&index_lock);
+  if (entry == NULL)
+    return;
+
+  if (entry->modified && !entry->logged)
+    {
+      entry->modified = false;
+      block_write (entry->block, entry->sector, entry->data);
+      COUNT (entry->stat, write_backs);
+    }
+  cache_put (entry);
+}
+
+/* Writes back every dirty entry that holds data of the file
+   whose inode is in sector OWNER, in ascending sector order, so
+   that the disk sees one sweep instead of scattered writes.
+   Other files' dirty entries stay in the cache.
+
+   The cache may be too big to sort all of its entries on the
+   stack, so each pass writes the FLUSH_BATCH lowest sectors
+   that are still dirty, until a pass finds no more. */
+void
+cache_flush_owner (block_sector_t owner)
+{
+  struct cache_entry *dirty[FLUSH_BATCH];
+  size_t match_cnt;
+
+  if (!is_cache_init)
+    return;
+
+  do
+    {
+      size_t dirty_cnt = 0;
+      size_t i, j;
+
+      /* Collect OWNER's dirty entries with the lowest sectors by
+         insertion sort, pinning each so it is not evicted. */
+      match_cnt = 0;
+      lock_acquire (&entry_lock);
+      for (i = 0; i < num_entries; i++)
+        {
+          struct cache_entry *entry = &cache[i];
+          if (entry->owner != owner || !entry->modified || entry->logged)
+            continue;
+          match_cnt++;
+          if (dirty_cnt == FLUSH_BATCH)
+            {
+              if (dirty[FLUSH_BATCH - 1]->sector < entry->sector)
+                continue;
+              dirty_cnt--;
+            }
+          for (j = dirty_cnt;
+               j > 0 && dirty[j - 1]->sector > entry->sector; j--)
+            dirty[j] = dirty[j - 1];
+          dirty[j] = entry;
+          dirty_cnt++;
+        }
+      for (i = 0; i < dirty_cnt; i++)
+        dirty[i]->ref_count++;
+      lock_release (&entry_lock);
+
+      for (i = 0; i < dirty_cnt; i++)
+        {
+          struct cache_entry *entry = dirty[i];
+
+          entry->modified = false;
+          block_write (entry->block, entry->sector, entry->data);
+          COUNT (entry->stat, write_backs);
+          cache_put (entry);
+        }
+    }
+  while (match_cnt > FLUSH_BATCH);
+}
+
+/* Prints the cache's hit rate and how contended its locks
+   were. */
+void
+cache_print_stats (void)
+{
+  printf ("Cache: %zu sectors, %d reads, %d hits\n",
+          num_entries, cache_read_cnt, cache_hit_cnt);
+  lock_print_stats (&entry_lock, "cache entry");
+  lock_print_stats (&clock_lock, "cache clock");
+  if (top_cnt > 0 && is_cache_init)
+    print_top_files ();
+}
+
+/* Prints the cache statistics of the top_cnt files with the most
+   misses, most first. */
+static void
+print_top_files (void)
+{
+  struct file_stat **top;
+  struct hash_iterator i;
+  int cnt = 0;
+  int j;
+
+  top = malloc (top_cnt * sizeof *top);
+  if (top == NULL)
+    return;
+
+  /* Insertion sort by misses, keeping only the top_cnt most. */
+  hash_first (&i, &file_stats);
+  while (hash_next (&i))
+    {
+      struct file_stat *f = hash_entry (hash_cur (&i), struct file_stat, elem);
+      uint32_t misses = f->stat.reads - f->stat.hits;
+
+      if (cnt == top_cnt)
+        {
+          if (top[cnt - 1]->stat.reads - top[cnt - 1]->stat.hits >= misses)
+            continue;
+          cnt--;
+        }
+      for (j = cnt;
+           j > 0 && top[j - 1]->stat.reads - top[j - 1]->stat.hits < misses;
+           j--)
+        top[j] = top[j - 1];
+      top[j] = f;
+      cnt++;
+    }
+
+  printf ("Cache: top %d of %zu files by misses:\n",
+          cnt, hash_size (&file_stats));
+  for (j = 0; j < cnt; j++)
+    {
+      const struct cache_stat *s = &top[j]->stat;
+      printf ("  inode %"PRIu32": %"PRIu32" misses, %"PRIu32" reads, "
+              "%"PRIu32" writes, %"PRIu32" evictions, "
+              "%"PRIu32" write-backs\n",
+              top[j]->owner, s->reads - s->hits, s->reads, s->writes,
+              s->evictions, s->write_backs);
+    }
+  free (top);
+}
+
+/* Returns the counts of the file whose inode is in sector OWNER,
+   adding them to file_stats if they are not there yet, or a null
+   pointer if memory runs out.  Called when the inode is opened,
+   so that its cache accesses need not look the counts up. */
+struct cache_stat *
+cache_file_stat (block_sector_t owner)
+{
+  struct file_stat key, *f;
+  struct hash_elem *e;
+
+  /* initialize cache list */
+  if (!is_cache_init)
+    {
+      cache_init ();
+      is_cache_init = true;
+    }
+
+  key.owner = owner;
+  lock_acquire (&file_stats_lock);
+  e = hash_find (&file_stats, &key.elem);
+  if (e != NULL)
+    f = hash_entry (e, struct file_stat, elem);
+  else if ((f = malloc (sizeof *f)) != NULL)
+    {
+      f->owner = owner;
+      memset (&f->stat, 0, sizeof f->stat);
+      hash_insert (&file_stats, &f->elem);
+    }
+  else
+    f = NULL;
+  lock_release (&file_stats_lock);
+
+  return f != NULL ? &f->stat : NULL;
+}
+
+/* Returns a hash of file_stat E's owner. */
+static unsigned
+file_stat_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+  return hash_int (hash_entry (e, struct file_stat, elem)->owner);
+}
+
+/* Returns true if file_stat A's owner precedes B's. */
+static bool
+file_stat_less (const struct hash_elem *a, const struct hash_elem *b,
+                void *aux UNUSED)
+{
+  return (hash_entry (a, struct file_stat, elem)->owner
+          < hash_entry (b, struct file_stat, elem)->owner);
 }
 
 /* student testing-1 */
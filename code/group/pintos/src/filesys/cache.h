@@ -1,3 +1,4 @@
+#include <hash.h>
 #include <list.h>
 #include <string.h>
 #include "threads/malloc.h"
@@ -6,10 +7,16 @@
 #include "filesys/file.h"
 #include "threads/synch.h"
 
+struct cache_stat;
+
+/* Owner of a cache entry that does not hold file data. */
+#define CACHE_NO_OWNER ((block_sector_t) -1)
+
 struct cache_entry 
   {
     bool accessed;				/* recently accessed */
     bool modified;				/* dirty bit */
+    bool logged;                /* In the running journal group, pinned. */
 
     int ref_count;				/* value > 0 indicates operation in progress */
     int n_chance;				/* for clock algorithm with N chances */
@@ -19,9 +26,17 @@ struct cache_entry
 
     struct block *block;        
     block_sector_t sector;      /* Sector number of disk location */
-    char data[512];				/* 512 bytes of data */
+    block_sector_t owner;       /* Inode sector of the file whose data
+                                   this is, or CACHE_NO_OWNER. */
+    struct cache_stat *stat;    /* Owner's statistics, or null. */
+    struct hash_elem index_elem; /* Element in the sector index. */
+    bool indexed;               /* In the sector index. */
+    uint8_t *data;              /* BLOCK_SECTOR_SIZE bytes of data, in a
+                                   page shared with other entries. */
   };
 
+void cache_configure (int cnt);
+void cache_configure_top (int cnt);
 void cache_init (void);
 void cache_entry_init (struct cache_entry *entry);
 
@@ -29,7 +44,25 @@ struct cache_entry * get_cache_entry (void);
 struct cache_entry * find_block_in_cache (struct block *block, block_sector_t sector);
 
 void cache_read (struct block *block, block_sector_t sector, void *buffer);
+void cache_read_owned (struct block *block, block_sector_t sector,
+                       void *buffer, block_sector_t owner,
+                       struct cache_stat *stat);
 void cache_write (struct block *block, block_sector_t sector, const void *buffer);
+void cache_write_owned (struct block *block, block_sector_t sector,
+                        const void *buffer, block_sector_t owner,
+                        struct cache_stat *stat);
+void cache_copy (struct block *block, block_sector_t dst, block_sector_t src,
+                 block_sector_t owner, struct cache_stat *stat);
+void cache_zero (struct block *block, block_sector_t sector,
+                 block_sector_t owner, struct cache_stat *stat);
+void cache_print_stats (void);
+struct cache_entry *cache_log (struct block *block, block_sector_t sector,
+                               const void *buffer, bool *newly_logged);
+void cache_checkpoint (struct cache_entry *entry);
+void cache_flush (void);
+void cache_flush_owner (block_sector_t owner);
+void cache_write_back (struct block *block, block_sector_t sector);
+struct cache_stat *cache_file_stat (block_sector_t owner);
 
 
 /* student testing-1 */
@@ -2,9 +2,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include <syscall-types.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -23,6 +25,16 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* Cache of open directories. */
+static struct kmem_cache *dir_cache;
+
+/* Initializes the directory module. */
+void
+dir_init (void)
+{
+  dir_cache = kmem_cache_create ("dir", sizeof (struct dir), NULL);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -36,7 +48,7 @@ dir_create (block_sector_t sector, size_t entry_cnt)
 struct dir *
 dir_open (struct inode *inode) 
 {
-  struct dir *dir = calloc (1, sizeof *dir);
+  struct dir *dir = kmem_cache_zalloc (dir_cache);
   if (inode != NULL && dir != NULL)
     {
       dir->inode = inode;
@@ -46,7 +58,7 @@ dir_open (struct inode *inode)
   else
     {
       inode_close (inode);
-      free (dir);
+      kmem_cache_free (dir_cache, dir);
       return NULL; 
     }
 }
@@ -74,7 +86,7 @@ dir_close (struct dir *dir)
   if (dir != NULL)
     {
       inode_close (dir->inode);
-      free (dir);
+      kmem_cache_free (dir_cache, dir);
     }
 }
 
@@ -126,18 +138,40 @@ dir_lookup (const struct dir *dir, const char *name,
   ASSERT (dir != NULL);
   ASSERT (name != NULL);
 
-  dir_lock (dir->inode);
+  dir_read_lock (dir->inode);
 
   if (lookup (dir, name, &e, NULL))
     *inode = inode_open (e.inode_sector);
   else
     *inode = NULL;
 
-  dir_unlock (dir->inode);
+  dir_read_unlock (dir->inode);
 
   return *inode != NULL;
 }
 
+/* Searches DIR for a file with the given NAME and, if one
+   exists, stores its attributes into ST without opening its
+   inode.  Returns true if successful, false if there is no such
+   file.  DIR stays locked until the inode has been read, since a
+   removal, which could free the inode's sectors, needs the lock
+   for writing. */
+bool
+dir_stat (const struct dir *dir, const char *name, struct stat *st)
+{
+  struct dir_entry e;
+  bool found;
+
+  ASSERT (dir != NULL);
+  ASSERT (name != NULL);
+
+  dir_read_lock (dir->inode);
+  found = lookup (dir, name, &e, NULL) && inode_stat (e.inode_sector, st);
+  dir_read_unlock (dir->inode);
+
+  return found;
+}
+
 /* Adds a file named NAME to DIR, which must not already contain a
    file by that name.  The file's inode is in sector
    INODE_SECTOR.
@@ -235,7 +269,7 @@ dir_remove (struct dir *dir, const char *name)
 bool
 dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
 {
-  dir_lock (dir->inode);
+  dir_read_lock (dir->inode);
 
   struct dir_entry e;
 
@@ -245,10 +279,46 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
       if (e.in_use)
         {
           strlcpy (name, e.name, NAME_MAX + 1);
-          dir_unlock (dir->inode);
+          dir_read_unlock (dir->inode);
           return true;
         } 
     }
-  dir_unlock (dir->inode);
+  dir_read_unlock (dir->inode);
   return false;
 }
+
+/* Reads up to CNT entries from DIR into ENTS, each with its name,
+   inode number, and whether it is a directory, starting where
+   the last read left off.  Entries are read from the inode
+   several at a time under one lock.  Returns the number of
+   entries read, which is 0 at the end of DIR. */
+size_t
+dir_readdir_batch (struct dir *dir, struct dirent *ents, size_t cnt)
+{
+  struct dir_entry e[16];
+  size_t n = 0;
+
+  dir_read_lock (dir->inode);
+  while (n < cnt)
+    {
+      size_t e_cnt = inode_read_at (dir->inode, e, sizeof e, dir->pos)
+                     / sizeof *e;
+      size_t i;
+
+      if (e_cnt == 0)
+        break;
+      for (i = 0; i < e_cnt && n < cnt; i++)
+        {
+          dir->pos += sizeof *e;
+          if (e[i].in_use)
+            {
+              ents[n].inumber = e[i].inode_sector;
+              ents[n].is_dir = inode_sector_is_dir (e[i].inode_sector);
+              strlcpy (ents[n].name, e[i].name, sizeof ents[n].name);
+              n++;
+            }
+        }
+    }
+  dir_read_unlock (dir->inode);
+  return n;
+}
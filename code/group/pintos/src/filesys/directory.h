@@ -12,8 +12,11 @@
 #define NAME_MAX 14
 
 struct inode;
+struct dirent;
+struct stat;
 
 /* Opening and closing directories. */
+void dir_init (void);
 bool dir_create (block_sector_t sector, size_t entry_cnt);
 struct dir *dir_open (struct inode *);
 struct dir *dir_open_root (void);
@@ -23,8 +26,10 @@ struct inode *dir_get_inode (struct dir *);
 
 /* Reading and writing. */
 bool dir_lookup (const struct dir *, const char *name, struct inode **);
+bool dir_stat (const struct dir *, const char *name, struct stat *);
 bool dir_add (struct dir *, const char *name, block_sector_t);
 bool dir_remove (struct dir *, const char *name);
 bool dir_readdir (struct dir *, char name[NAME_MAX + 1]);
+size_t dir_readdir_batch (struct dir *, struct dirent *, size_t cnt);
 
 #endif /* filesys/directory.h */
@@ -2,6 +2,7 @@
 #include <debug.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* An open file. */
 struct file 
@@ -11,13 +12,23 @@ struct file
     bool deny_write;            /* Has file_deny_write() been called? */
   };
 
+/* Cache of open files. */
+static struct kmem_cache *file_cache;
+
+/* Initializes the file module. */
+void
+file_init (void)
+{
+  file_cache = kmem_cache_create ("file", sizeof (struct file), NULL);
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
    and returns the new file.  Returns a null pointer if an
    allocation fails or if INODE is null. */
 struct file *
 file_open (struct inode *inode) 
 {
-  struct file *file = calloc (1, sizeof *file);
+  struct file *file = kmem_cache_zalloc (file_cache);
   if (inode != NULL && file != NULL)
     {
       file->inode = inode;
@@ -28,7 +39,7 @@ file_open (struct inode *inode)
   else
     {
       inode_close (inode);
-      free (file);
+      kmem_cache_free (file_cache, file);
       return NULL; 
     }
 }
@@ -49,7 +60,7 @@ file_close (struct file *file)
     {
       file_allow_write (file);
       inode_close (file->inode);
-      free (file); 
+      kmem_cache_free (file_cache, file); 
     }
 }
 
@@ -113,6 +124,48 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies SIZE bytes from IN, starting at its current position,
+   to OUT, starting at its current position, without passing the
+   data through a caller's buffer.  Advances both positions by
+   the number of bytes copied, which is returned and may be less
+   than SIZE if end of IN is reached.  Returns -1, copying
+   nothing, if IN and OUT are the same file and the ranges
+   overlap. */
+off_t
+file_copy (struct file *in, struct file *out, off_t size)
+{
+  off_t bytes_copied = inode_copy_range (in->inode, in->pos,
+                                         out->inode, out->pos, size);
+  if (bytes_copied > 0)
+    {
+      in->pos += bytes_copied;
+      out->pos += bytes_copied;
+    }
+  return bytes_copied;
+}
+
+/* Writes FILE's dirty data to disk, and its inode too unless
+   DATA_ONLY is true and the file has not grown.  See
+   inode_sync(). */
+void
+file_sync (struct file *file, bool data_only)
+{
+  ASSERT (file != NULL);
+  inode_sync (file->inode, data_only);
+}
+
+/* Allocates disk sectors for the first LENGTH bytes of FILE,
+   extending it to LENGTH bytes if it is shorter.  Returns true if
+   successful, false if writes are denied, the disk is full, or
+   LENGTH is too long.
+   See inode_allocate_range(). */
+bool
+file_allocate (struct file *file, off_t length)
+{
+  ASSERT (file != NULL);
+  return inode_allocate_range (file->inode, length);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
@@ -6,6 +6,8 @@
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/cache.h"
+#include "filesys/journal.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -13,6 +15,7 @@
 struct block *fs_device;
 
 static void do_format (void);
+static block_sector_t inode_goal (struct dir *, int is_dir);
 
 bool is_filesys_init = false;
 
@@ -26,7 +29,10 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  file_init ();
+  dir_init ();
   free_map_init ();
+  journal_init (format);
 
   if (format) 
     do_format ();
@@ -44,6 +50,8 @@ void
 filesys_done (void) 
 {
   free_map_close ();
+  journal_flush ();
+  cache_flush ();
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -115,7 +123,8 @@ filesys_create (const char *name, off_t initial_size, int is_dir)
 
 
   bool success = (dir != NULL
-                  && free_map_allocate (1, &inode_sector)
+                  && free_map_allocate_near (1, inode_goal (dir, is_dir),
+                                             &inode_sector)
                   && inode_create (inode_sector, initial_size, is_dir)
                   && dir_add (dir, part, inode_sector));
   if (!success && inode_sector != 0) 
@@ -125,6 +134,17 @@ filesys_create (const char *name, off_t initial_size, int is_dir)
   return success;
 }
 
+/* Returns the sector near which to put the inode of a new file
+   in DIR: in DIR's own block group, or for a new directory
+   (IS_DIR nonzero) in the group with the most room. */
+static block_sector_t
+inode_goal (struct dir *dir, int is_dir)
+{
+  if (is_dir)
+    return free_map_dir_goal ();
+  return inode_get_inumber (dir_get_inode (dir));
+}
+
 /* Opens the file with the given NAME.
    Returns the new file if successful or a null pointer
    otherwise.
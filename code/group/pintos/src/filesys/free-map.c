@@ -1,12 +1,49 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "filesys/journal.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+
+/* The disk is split into block groups of this many sectors.  A
+   file's inode goes in its directory's group and its data after
+   its inode, so that related sectors end up close together. */
+#define GROUP_SECTORS 512
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static size_t group_cnt;             /* Number of block groups. */
+static size_t *group_free;           /* Free sectors in each group. */
+static struct lock free_map_lock;    /* Protects the above. */
+
+/* Adds DELTA to the free counts of the groups holding the CNT
+   sectors that start at SECTOR. */
+static void
+count_free (block_sector_t sector, size_t cnt, int delta)
+{
+  for (; cnt > 0; sector++, cnt--)
+    group_free[sector / GROUP_SECTORS] += delta;
+}
+
+/* Recomputes every group's free count from the free map. */
+static void
+recount_groups (void)
+{
+  size_t sector_cnt = bitmap_size (free_map);
+  size_t i;
+
+  for (i = 0; i < group_cnt; i++)
+    {
+      size_t start = i * GROUP_SECTORS;
+      size_t len = sector_cnt - start < GROUP_SECTORS ? sector_cnt - start
+                                                      : GROUP_SECTORS;
+      group_free[i] = bitmap_count (free_map, start, len, false);
+    }
+}
 
 /* Initializes the free map. */
 void
@@ -17,6 +54,14 @@ free_map_init (void)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  bitmap_set_multiple (free_map, JOURNAL_SECTOR, JOURNAL_SECTORS, true);
+
+  group_cnt = DIV_ROUND_UP (bitmap_size (free_map), GROUP_SECTORS);
+  group_free = malloc (group_cnt * sizeof *group_free);
+  if (group_free == NULL)
+    PANIC ("block group creation failed");
+  recount_groups ();
+  lock_init (&free_map_lock);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -27,7 +72,33 @@ free_map_init (void)
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  return free_map_allocate_near (cnt, 0, sectorp);
+}
+
+/* Like free_map_allocate(), but takes the first free run at or
+   after sector GOAL, skipping groups too full to hold CNT
+   sectors, and wraps around to the start of the disk only if
+   there is none. */
+bool
+free_map_allocate_near (size_t cnt, block_sector_t goal,
+                        block_sector_t *sectorp)
+{
+  block_sector_t sector = BITMAP_ERROR;
+  size_t g;
+
+  lock_acquire (&free_map_lock);
+  if (goal >= bitmap_size (free_map))
+    goal = 0;
+  for (g = goal / GROUP_SECTORS; g < group_cnt; g++)
+    if (group_free[g] >= cnt)
+      {
+        block_sector_t start = g * GROUP_SECTORS;
+        sector = bitmap_scan_and_flip (free_map, start > goal ? start : goal,
+                                       cnt, false);
+        break;
+      }
+  if (sector == BITMAP_ERROR)
+    sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
   if (sector != BITMAP_ERROR
       && free_map_file != NULL
       && !bitmap_write (free_map, free_map_file))
@@ -36,17 +107,42 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
       sector = BITMAP_ERROR;
     }
   if (sector != BITMAP_ERROR)
-    *sectorp = sector;
+    {
+      count_free (sector, cnt, -1);
+      *sectorp = sector;
+    }
+  lock_release (&free_map_lock);
   return sector != BITMAP_ERROR;
 }
 
+/* Returns the first sector of the group where a new directory
+   should go: the one with the most free sectors, so that
+   directories, and the files that will follow them, spread over
+   the disk instead of crowding its start. */
+block_sector_t
+free_map_dir_goal (void)
+{
+  size_t best = 0;
+  size_t g;
+
+  lock_acquire (&free_map_lock);
+  for (g = 1; g < group_cnt; g++)
+    if (group_free[g] > group_free[best])
+      best = g;
+  lock_release (&free_map_lock);
+  return best * GROUP_SECTORS;
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
   bitmap_set_multiple (free_map, sector, cnt, false);
+  count_free (sector, cnt, 1);
   bitmap_write (free_map, free_map_file);
+  lock_release (&free_map_lock);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -58,6 +154,7 @@ free_map_open (void)
     PANIC ("can't open free map");
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  recount_groups ();
 }
 
 /* Writes the free map to disk and closes the free map file. */
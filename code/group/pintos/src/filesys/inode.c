@@ -3,28 +3,30 @@
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include <syscall-types.h>
+#include "filesys/cache.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/journal.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 
 /* Added function prototypes */
-uint32_t new_space (struct inode* inode, uint32_t new_size);
 static block_sector_t byte_to_sector_direct (const struct inode *inode, off_t pos);
 static block_sector_t byte_to_sector_indirect_l1 (const struct inode *inode, off_t pos);
 static block_sector_t byte_to_sector_indirect_l2 (const struct inode *inode, off_t pos);
-uint32_t inode_close_indirect_l1 (struct inode *inode, uint32_t dir_sector, int counter);
-uint32_t inode_close_indirect_l2 (struct inode *inode, uint32_t dir_sector, uint32_t l1_sector);
-int get_chunk_size (struct inode *inode, off_t size, off_t offset, block_sector_t sector_ofs);
-uint32_t file_ext_direct (struct inode* inode, uint32_t size_to_add);
-uint32_t file_ext_indirect_l1 (struct inode* inode, uint32_t size_to_add);
-uint32_t file_ext_indirect_l2 (struct inode* inode, uint32_t size_to_add);
-uint32_t file_ext (struct inode* inode, uint32_t new_size);
-void free_indirect (block_sector_t* sector, int num_ptrs);
+int get_chunk_size (off_t length, off_t size, off_t offset, block_sector_t sector_ofs);
+void free_indirect (block_sector_t sector, int level);
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Bounds, in sectors, on the run reserved ahead of a file that is
+   being written in order.  Each run is twice the last. */
+#define PREALLOC_MIN 8
+#define PREALLOC_MAX 64
+
 /* Constants */
 #define NUMBER_DIRECT 100
 #define BLOCK_POINTERS 128
@@ -32,6 +34,19 @@ void free_indirect (block_sector_t* sector, int num_ptrs);
 #define L2_PLACE 101
 #define NUM_BLOCKS 102
 
+/* Longest file the block map can describe. */
+#define MAX_LENGTH ((NUMBER_DIRECT + BLOCK_POINTERS                     \
+                     + BLOCK_POINTERS * BLOCK_POINTERS) * BLOCK_SECTOR_SIZE)
+
+/* A block pointer that is a hole: no sector is allocated, and
+   the bytes it covers read as zeros.  Sector 0 holds the free
+   map's inode, so it is never a data or indirect block. */
+#define HOLE ((block_sector_t) 0)
+
+/* Bytes of data an inode sector can hold in place of its block
+   map: all of it but the four header words, that is, 496 bytes,
+   or 24 directory entries. */
+#define INLINE_MAX (BLOCK_SECTOR_SIZE - 4 * sizeof (int))
 
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
@@ -42,15 +57,17 @@ struct inode_disk
     unsigned magic;                     /* Magic number. */
 
     /* Added by group 51 */
-    block_sector_t blocks[NUM_BLOCKS];  /* data (100 direct, 1 L1, 1 L2, 125 bytes */
-    int cur_index;
-    int l1_index;
-    int l2_index;
-
     int is_dir;                         /* 0: file, 1: directory */
-
-    uint32_t unused[20];                /* Filler. */
-
+    int is_inline;                      /* 1: data is stored below. */
+
+    /* A file or directory of at most INLINE_MAX bytes keeps its
+       data here, so reading it takes no sector beyond this one. */
+    union
+      {
+        block_sector_t blocks[NUM_BLOCKS]; /* 100 direct, 1 L1, 1 L2,
+                                           each possibly a HOLE. */
+        uint8_t data[INLINE_MAX];       /* Inline data. */
+      };
   };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -75,20 +92,56 @@ struct inode
 
     /* added by group 51 */
 
-    /* list of pointers to the on disk blocks */
+    /* list of pointers to the on disk blocks, or the data
+       itself while is_inline */
     /* must be the same size as above */
-    block_sector_t blocks[NUM_BLOCKS];
-
-    int cur_index;                     /* maps to max block being used */
-    int l1_index;                      /* cur pos in any l1 indirection block */
-    int l2_index;                      /* cur pos in any l2 block */
-
-    off_t cur_off;                      /* the current offset we have read to */
-    off_t cur_size;                     /* the current file size */
+    union
+      {
+        block_sector_t blocks[NUM_BLOCKS];
+        uint8_t data[INLINE_MAX];
+      };
+
+    /* A file grows in two steps.  A write past the end first
+       reserves its range by raising cur_size, and then writes its
+       data, allocating sectors for the holes it fills.  cur_off,
+       the length readers see, catches up only once no extension
+       is in flight, so readers never see a reserved range before
+       its data is written.  Both change only under inode_lock
+       held for writing.  Writes within cur_size, including to
+       ranges reserved by other writers, run in parallel. */
+    off_t cur_off;                      /* Length visible to readers. */
+    off_t cur_size;                     /* Length reserved by writers. */
+    int extend_cnt;                     /* Extensions not yet visible. */
+    bool meta_dirty;                    /* Grown since last written. */
+    block_sector_t alloc_goal;          /* Where to look for the next
+                                           sector to allocate. */
+    struct cache_stat *cache_stat;      /* Buffer cache counts, or null. */
+
+    /* Sectors taken from the free map ahead of need, so that a
+       file written in order gets one run of sectors for many
+       allocations.  They are used up before the free map is
+       asked again, and given back when the file is last closed.
+       A crash before then leaks them. */
+    block_sector_t prealloc_start;      /* First reserved sector. */
+    size_t prealloc_cnt;                /* Number of reserved sectors. */
+    size_t prealloc_next;               /* Size of the next speculative
+                                           reservation. */
+    size_t next_idx;                    /* Sector index after the one
+                                           last allocated. */
 
     int is_dir;                         /* 0: file, 1: directory */
 
-    struct lock inode_lock;             /* inode syncronization */
+    /* Data lives in the union above until a write takes the file
+       past INLINE_MAX bytes, when inode_extend() moves it to a
+       data block.  Changes only from true to false, under
+       inode_lock held for writing. */
+    bool is_inline;
+
+    /* Held for reading while a file's block map is looked up and
+       for writing while the file is extended.  A directory holds
+       it through dir_lock() or dir_read_lock() instead, around
+       whole directory operations. */
+    struct rwlock inode_lock;
 
   };
 
@@ -104,9 +157,11 @@ static block_sector_t
 byte_to_sector_indirect_l1 (const struct inode *inode, off_t pos) 
 {
   /* buffer for block read */
-  int ptr_buffer[BLOCK_POINTERS];
+  block_sector_t ptr_buffer[BLOCK_POINTERS];
 
   /* index 100 is l1 indirection */
+  if (inode->blocks[L1_PLACE] == HOLE)
+    return HOLE;
   cache_read(fs_device, inode->blocks[L1_PLACE], &ptr_buffer);
 
   /* subtract off direct ptrs from pos (100*512), mod by (128*512)*/
@@ -120,15 +175,19 @@ static block_sector_t
 byte_to_sector_indirect_l2 (const struct inode *inode, off_t pos) 
 {
   /* to read the l2 block with more pointers */
-  int ptr_buffer[BLOCK_POINTERS];
+  block_sector_t ptr_buffer[BLOCK_POINTERS];
 
   /* index 101 is the l2 indirection in blocks */
+  if (inode->blocks[L2_PLACE] == HOLE)
+    return HOLE;
   cache_read(fs_device, inode->blocks[L2_PLACE], &ptr_buffer);
 
   /* pos -= (ind ptrs + dir ptrs) * 512; this reps num of bytes into l2 */
   pos -= (NUMBER_DIRECT+BLOCK_POINTERS)*BLOCK_SECTOR_SIZE;
 
   /* reflects the index of l2: pos / (512*128ptrs) */
+  if (ptr_buffer[pos/(BLOCK_POINTERS*BLOCK_SECTOR_SIZE)] == HOLE)
+    return HOLE;
   cache_read(fs_device, ptr_buffer[pos/(BLOCK_POINTERS*BLOCK_SECTOR_SIZE)], &ptr_buffer);
 
   /* mod by indirect nodes*byte size(128*512)*/
@@ -137,10 +196,27 @@ byte_to_sector_indirect_l2 (const struct inode *inode, off_t pos)
   return ptr_buffer[pos/BLOCK_SECTOR_SIZE];
 }
 
+/* Looks up the sector that holds byte offset POS of INODE in its
+   block map, which may be a HOLE, whether or not POS is within
+   INODE's length. */
+static block_sector_t
+lookup_sector (const struct inode *inode, off_t pos)
+{
+  /* DIRECT , elif L1, else L2*/
+  if (pos < NUMBER_DIRECT*BLOCK_SECTOR_SIZE)                       /* Is still in direct ptr range 100*512 */
+    return byte_to_sector_direct (inode, pos);
+
+  else if (pos < BLOCK_SECTOR_SIZE*(NUMBER_DIRECT+BLOCK_POINTERS)) /* in the l1 indirect (512 * (128l1+100dir))*/
+    return byte_to_sector_indirect_l1 (inode, pos);
+
+  else                                                             /* in the l2 indirect (128^2*512) */
+    return byte_to_sector_indirect_l2 (inode, pos);
+}
+
 /* Returns the block device sector that contains byte offset POS
-   within INODE.
+   within INODE, or HOLE if none has been allocated yet.
    Returns -1 if INODE does not contain data for a byte at offset
-   POS. */
+   POS, or keeps its data inline. */
 static block_sector_t
 byte_to_sector (const struct inode *inode, off_t pos, bool is_write) 
 {
@@ -148,36 +224,246 @@ byte_to_sector (const struct inode *inode, off_t pos, bool is_write)
 
   off_t size_to_compare;
 
+  if (inode->is_inline)
+    return -1;
   if (is_write)
     size_to_compare = inode->cur_size;
   else
     size_to_compare = inode->cur_off;
 
   if (pos < size_to_compare) 
+    return lookup_sector (inode, pos);
+  
+  return -1;
+}
+
+/* A sector of zeros. */
+static const uint8_t zeros[BLOCK_SECTOR_SIZE];
+
+/* Returns true if INODE's contents are file system metadata,
+   which is written through the journal: a directory, or the free
+   map. */
+static bool
+inode_is_metadata (const struct inode *inode)
+{
+  return inode->is_dir || inode->sector == FREE_MAP_SECTOR;
+}
+
+/* Writes BUFFER to SECTOR, which holds data of INODE.  The
+   contents of directories and of the free map are metadata, so
+   they go through the journal. */
+static void
+write_sector (struct inode *inode, block_sector_t sector, const void *buffer)
+{
+  if (inode_is_metadata (inode))
+    journal_write (sector, buffer);
+  else
+    cache_write_owned (fs_device, sector, buffer, inode->sector,
+                       inode->cache_stat);
+}
+
+/* Allocates a sector for INODE into *PTR as close after the one
+   it allocated last, or after INODE itself, as the free map
+   allows, so that a file written in order is laid out in order
+   near its inode.  Returns true if successful, false if the disk
+   is full. */
+static bool
+allocate_near (struct inode *inode, block_sector_t *ptr)
+{
+  if (inode->prealloc_cnt > 0)
     {
-      /* DIRECT , elif L1, else L2*/
-      if (pos < NUMBER_DIRECT*BLOCK_SECTOR_SIZE)                       /* Is still in direct ptr range 100*512 */
-        return byte_to_sector_direct (inode, pos);
+      *ptr = inode->prealloc_start++;
+      inode->prealloc_cnt--;
+    }
+  else if (!free_map_allocate_near (1, inode->alloc_goal, ptr))
+    return false;
+  inode->alloc_goal = *ptr + 1;
+  return true;
+}
+
+/* Reserves a run of CNT sectors for INODE's next allocations,
+   near its goal, unless it already holds a reservation or no
+   such run is free.  Returns true if INODE holds a reservation
+   afterward. */
+static bool
+prealloc (struct inode *inode, size_t cnt)
+{
+  if (inode->prealloc_cnt == 0 && cnt > 0
+      && free_map_allocate_near (cnt, inode->alloc_goal,
+                                 &inode->prealloc_start))
+    inode->prealloc_cnt = cnt;
+  return inode->prealloc_cnt > 0;
+}
 
-      else if (pos < BLOCK_SECTOR_SIZE*(NUMBER_DIRECT+BLOCK_POINTERS)) /* in the l1 indirect (512 * (128l1+100dir))*/
-        return byte_to_sector_indirect_l1 (inode, pos);
+/* Gives INODE's reserved sectors back to the free map. */
+static void
+prealloc_trim (struct inode *inode)
+{
+  if (inode->prealloc_cnt > 0)
+    free_map_release (inode->prealloc_start, inode->prealloc_cnt);
+  inode->prealloc_cnt = 0;
+}
 
-      else                                                             /* in the l2 indirect (128^2*512) */
-        return byte_to_sector_indirect_l2 (inode, pos);
+/* Allocates a data sector of INODE into *PTR, a hole, and fills
+   it with zeros.  A file's zeros go only into the cache, so a
+   sector that is written soon is not written twice, but the
+   sector is ordered in the journal: the zeros, or whatever is
+   written over them, reach disk before any inode or indirect
+   block that points to the sector is committed.  Returns the
+   sector, or -1 if the disk is full. */
+static block_sector_t
+allocate_data (struct inode *inode, block_sector_t *ptr)
+{
+  if (!allocate_near (inode, ptr))
+    return -1;
+  if (inode_is_metadata (inode))
+    write_sector (inode, *ptr, zeros);
+  else
+    {
+      cache_zero (fs_device, *ptr, inode->sector, inode->cache_stat);
+      journal_order (*ptr);
     }
-  
-  return -1;
+  return *ptr;
+}
+
+/* Allocates data sector IDX of those below the indirect block in
+   *PTR, which is LEVEL levels above the data, along with any
+   indirect blocks on the way that are holes.  Returns the
+   sector, or -1 if the disk is full, in which case nothing stays
+   allocated. */
+static block_sector_t
+allocate_indirect (struct inode *inode, block_sector_t *ptr, size_t idx,
+                   int level)
+{
+  block_sector_t indirect[BLOCK_POINTERS];
+  block_sector_t *entry;
+  block_sector_t old, sector;
+  size_t span = level == 1 ? 1 : BLOCK_POINTERS;
+  bool new_block = *ptr == HOLE;
+
+  if (new_block)
+    {
+      if (!allocate_near (inode, ptr))
+        return -1;
+      memset (indirect, 0, sizeof indirect);
+    }
+  else
+    cache_read (fs_device, *ptr, &indirect);
+
+  entry = &indirect[idx / span];
+  old = *entry;
+  if (level == 1)
+    sector = allocate_data (inode, entry);
+  else
+    sector = allocate_indirect (inode, entry, idx % span, level - 1);
+
+  if (sector == (block_sector_t) -1)
+    {
+      if (new_block)
+        {
+          free_map_release (*ptr, 1);
+          *ptr = HOLE;
+        }
+    }
+  else if (new_block || *entry != old)
+    journal_write (*ptr, &indirect);
+  return sector;
+}
+
+/* Allocates the sector holding byte POS of INODE, which must be a
+   hole, and any indirect blocks on the way.  INODE's lock must be
+   held for writing.  Returns the sector, or -1 if the disk is
+   full. */
+static block_sector_t
+allocate_sector (struct inode *inode, off_t pos)
+{
+  size_t idx = pos / BLOCK_SECTOR_SIZE;
+
+  /* A file that keeps allocating the sector after its last one
+     is being written in order, probably appended to, so reserve
+     a run, longer each time, to lay it out in. */
+  if (idx == inode->next_idx && inode->prealloc_cnt == 0
+      && !inode_is_metadata (inode))
+    {
+      if (prealloc (inode, inode->prealloc_next)
+          && inode->prealloc_next < PREALLOC_MAX)
+        inode->prealloc_next *= 2;
+    }
+  inode->next_idx = idx + 1;
+
+  inode->meta_dirty = true;
+  if (idx < NUMBER_DIRECT)
+    return allocate_data (inode, &inode->blocks[idx]);
+  idx -= NUMBER_DIRECT;
+  if (idx < BLOCK_POINTERS)
+    return allocate_indirect (inode, &inode->blocks[L1_PLACE], idx, 1);
+  idx -= BLOCK_POINTERS;
+  return allocate_indirect (inode, &inode->blocks[L2_PLACE], idx, 2);
 }
 
 /* List of open inodes, so that opening a single inode twice
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects open_inodes and the inodes' open counts.  Directory
+   lookups run in parallel under dir_read_lock(), so they may
+   open the same inode at once. */
+static struct lock open_inodes_lock;
+
+/* Cache of in-memory inodes. */
+static struct kmem_cache *inode_cache;
+
+/* Constructs in-memory inode INODE.  Its lock is never held
+   when the inode is freed. */
+static void
+inode_ctor (void *inode_)
+{
+  struct inode *inode = inode_;
+  rwlock_init (&inode->inode_lock);
+}
+
+/* Locks INODE's block map against extension, unless INODE is a
+   directory, whose callers already hold its lock. */
+static void
+inode_read_lock (struct inode *inode)
+{
+  if (!inode->is_dir)
+    rwlock_acquire_read (&inode->inode_lock);
+}
+
+/* Releases the lock taken by inode_read_lock(). */
+static void
+inode_read_unlock (struct inode *inode)
+{
+  if (!inode->is_dir)
+    rwlock_release_read (&inode->inode_lock);
+}
+
+/* Locks INODE's block map and length for a change, unless INODE
+   is a directory, whose callers already hold its lock. */
+static void
+inode_write_lock (struct inode *inode)
+{
+  if (!inode->is_dir)
+    rwlock_acquire_write (&inode->inode_lock);
+}
+
+/* Releases the lock taken by inode_write_lock(). */
+static void
+inode_write_unlock (struct inode *inode)
+{
+  if (!inode->is_dir)
+    rwlock_release_write (&inode->inode_lock);
+}
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  lock_init (&open_inodes_lock);
+  inode_cache = kmem_cache_create ("inode", sizeof (struct inode),
+                                   inode_ctor);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -204,42 +490,32 @@ inode_create (block_sector_t sector, off_t length, int is_dir)
       disk_inode->magic = INODE_MAGIC;
       disk_inode->is_dir = is_dir;
 
-      size_t sectors = bytes_to_sectors (length);
+      /* Small inodes start inline, with calloc()'s zeros as data.
+         Larger ones start as one hole, calloc()'s zeros again, and
+         get sectors as they are written. */
+      disk_inode->is_inline = (size_t) length <= INLINE_MAX;
+      success = length <= MAX_LENGTH;
 
-      /* Allocate new inode/set fields to zero (file_ext will set them to real vals) */
-      struct inode node;
-      node.cur_index = 0;
-      node.l1_index = 0;
-      node.l2_index = 0;
-      node.cur_size = 0;
+      /* Except the free map: filling a hole in it would allocate
+         from the free map while it is being written, so its
+         sectors are all allocated now, before it is opened. */
+      if (!disk_inode->is_inline && sector == FREE_MAP_SECTOR && success)
+        {
+          struct inode node;
+          off_t pos;
 
-      file_ext (&node, length);
+          memset (&node, 0, sizeof node);
+          node.sector = sector;
+          for (pos = 0; pos < length && success; pos += BLOCK_SECTOR_SIZE)
+            success = allocate_sector (&node, pos) != (block_sector_t) -1;
 
-      if (sectors > 0) 
-        {
-          static char zeros[BLOCK_SECTOR_SIZE];
-          size_t i;
-          
-          for (i = 0; i < sectors; i++) 
-            {
-              if (i == 100)
-                break;
-              cache_write (fs_device, node.blocks[i], zeros);
-            }
+          /* copy over all the blocks from the inode in mem to inode on disk */
+          memcpy (&disk_inode->blocks, &node.blocks, sizeof (block_sector_t) * NUM_BLOCKS);
         }
-      /* copy over all the blocks from the inode in mem to inode on disk */
-      memcpy (&disk_inode->blocks, &node.blocks, sizeof (block_sector_t) * NUM_BLOCKS);
-
-      /* copy metadata created from file_ext from inode to disk inode */
-      disk_inode->cur_index = node.cur_index;
-      disk_inode->l1_index = node.l1_index;
-      disk_inode->l2_index = node.l2_index;
-      //disk_inode->is_dir = node.is_dir;
 
       /* write the new disk inode to disk */
-      cache_write (fs_device, sector, disk_inode);
-
-      success = true;
+      if (success)
+        journal_write (sector, disk_inode);
 
       /* Get disk inode out of memory */
       free (disk_inode);
@@ -257,25 +533,29 @@ inode_open (block_sector_t sector)
   struct inode *inode;
 
   /* Check whether this inode is already open. */
+  lock_acquire (&open_inodes_lock);
   for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
        e = list_next (e)) 
     {
       inode = list_entry (e, struct inode, elem);
       if (inode->sector == sector) 
         {
-          inode_reopen (inode);
+          inode->open_cnt++;
+          lock_release (&open_inodes_lock);
           return inode; 
         }
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (inode_cache);
   if (inode == NULL)
-    return NULL;
+    {
+      lock_release (&open_inodes_lock);
+      return NULL;
+    }
 
-  /* Initialize. */
+  /* Initialize.  inode_ctor() has set up the lock. */
   list_push_front (&open_inodes, &inode->elem);
-  lock_init (&inode->inode_lock);
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
@@ -284,15 +564,21 @@ inode_open (block_sector_t sector)
   struct inode_disk data;
   cache_read (fs_device, inode->sector, &data);
 
-  /* new data initialized */
-  memcpy (&inode->blocks, &data.blocks, sizeof(block_sector_t)*NUM_BLOCKS);
-  inode->cur_index = data.cur_index;
-  inode->l1_index = data.l1_index;
-  inode->l2_index = data.l2_index;
+  /* new data initialized; the block map or the inline data */
+  memcpy (&inode->data, &data.data, INLINE_MAX);
+  inode->is_inline = data.is_inline;
   inode->cur_size = data.length;
   inode->cur_off = data.length;
+  inode->extend_cnt = 0;
+  inode->meta_dirty = false;
+  inode->alloc_goal = sector + 1;
+  inode->cache_stat = cache_file_stat (sector);
+  inode->prealloc_cnt = 0;
+  inode->prealloc_next = PREALLOC_MIN;
+  inode->next_idx = 0;
   inode->is_dir = data.is_dir;
   /* end inode inits here */
+  lock_release (&open_inodes_lock);
 
   return inode;
 }
@@ -302,7 +588,11 @@ struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      lock_acquire (&open_inodes_lock);
+      inode->open_cnt++;
+      lock_release (&open_inodes_lock);
+    }
   return inode;
 }
 
@@ -313,138 +603,113 @@ inode_get_inumber (const struct inode *inode)
   return inode->sector;
 }
 
-uint32_t inode_close_indirect_l1 (struct inode *inode, uint32_t dir_sector, int counter)
+/* Writes INODE's length and block map to its sector, through
+   the journal.  A file's data goes through the cache rather than
+   the journal and stays there; only the sectors allocated since
+   the last commit are written back before the next one, by
+   journal_order(). */
+static void
+inode_write_disk (struct inode *inode)
 {
-  int num_ptrs;
-  int l1_sector;
+  /* ref inode_create for similar code */
+  struct inode_disk disk_node;
 
-  uint32_t num = inode->cur_size - BLOCK_SECTOR_SIZE * NUMBER_DIRECT;
-  uint32_t denom = BLOCK_SECTOR_SIZE;
-  l1_sector = (num + (denom - 1)) / denom;
+  memset (&disk_node, 0, sizeof disk_node);
+  disk_node.magic = INODE_MAGIC;
+  disk_node.length = inode->cur_size;
+  disk_node.is_dir = inode->is_dir;
+  disk_node.is_inline = inode->is_inline;
 
-  /* check if we are using any indirect blocks */
-  if (l1_sector != 0 && counter == NUMBER_DIRECT)
-    {
-      /* num ptrs remaining is the min between 128 & dir_sector */ 
-      if (dir_sector > BLOCK_POINTERS) 
-        num_ptrs = BLOCK_POINTERS;
-      else 
-        num_ptrs = dir_sector;
-
-      free_indirect (&inode->blocks[L1_PLACE], num_ptrs);
+  /* copy the data (total num of blocks, or inline data) */
+  memcpy(&disk_node.data, &inode->data, INLINE_MAX);
 
-      l1_sector -= 1;
-    }
-  return l1_sector;
+  /* Write the struct to fs_device from inode sector*/
+  journal_write (inode->sector, &disk_node);
+  inode->meta_dirty = false;
 }
 
-uint32_t inode_close_indirect_l2 (struct inode *inode, uint32_t dir_sector, uint32_t l1_sector)
+/* Releases the data and indirect blocks of INODE, which is not
+   inline. */
+static void
+inode_free_blocks (struct inode *inode)
 {
-  /* all direct, indirect mult by size of a block */
-  /* represents if we need to go into l2 */
-  int min_l2 = (BLOCK_POINTERS+NUMBER_DIRECT) * BLOCK_SECTOR_SIZE;
+  int i;
 
-  if (inode->cur_size > min_l2)
-    {
-      block_sector_t indirect_l1[BLOCK_POINTERS];
+  /* DIRECT BLOCK */
+  for (i = 0; i < NUMBER_DIRECT; i++)
+    if (inode->blocks[i] != HOLE)
+      free_map_release (inode->blocks[i], 1);
 
-      cache_read(fs_device, inode->blocks[L2_PLACE], &indirect_l1);
-
-      int tmp_ptrs;
-      for(tmp_ptrs = l1_sector-1; tmp_ptrs >= 0; tmp_ptrs--)
-        {
-          int l2_num_ptrs;
-          
-          if (dir_sector > BLOCK_POINTERS)
-            l2_num_ptrs = BLOCK_POINTERS;
-          
-          else
-            l2_num_ptrs = dir_sector;
-
-          free_indirect (&indirect_l1[tmp_ptrs], l2_num_ptrs);
-          dir_sector -= l2_num_ptrs;
-        }
-
-      free_map_release (inode->blocks[L2_PLACE], 1);
-    }
-  return dir_sector;
+  /* L1 INDIRECTION, L2 INDIRECTION */
+  free_indirect (inode->blocks[L1_PLACE], 1);
+  free_indirect (inode->blocks[L2_PLACE], 2);
 }
 
-/* Closes INODE and writes it to disk.
+/* Closes INODE and writes it to disk if it changed.
    If this was the last reference to INODE, frees its memory.
    If INODE was also a removed inode, frees its blocks. */
 void
 inode_close (struct inode *inode) 
 {
+  bool last;
+
   /* Ignore null pointer. */
   if (inode == NULL)
     return;
 
+  /* Remove from inode list if this was the last opener. */
+  lock_acquire (&open_inodes_lock);
+  last = --inode->open_cnt == 0;
+  if (last)
+    list_remove (&inode->elem);
+  lock_release (&open_inodes_lock);
+
   /* Release resources if this was the last opener. */
-  if (--inode->open_cnt == 0)
+  if (last)
     {
-      /* Remove from inode list and release lock. */
-      list_remove (&inode->elem);
- 
+      /* Trim preallocation past what was written. */
+      prealloc_trim (inode);
+
       /* Deallocate blocks if removed. */
       if (inode->removed) 
         {
           /* This was originally included, still need it */
           free_map_release (inode->sector, 1);
+          if (!inode->is_inline)
+            inode_free_blocks (inode);
 
-          /* round up int division */
-          /* num: inode->cur_size denom: BLOCK_SECTOR_SIZE */
-          uint32_t dir_sector = (inode->cur_size + (BLOCK_SECTOR_SIZE - 1)) / BLOCK_SECTOR_SIZE;
-
-          /* DIRECT BLOCK */
-          int counter;
-          for (counter = 0; counter < NUMBER_DIRECT && dir_sector != 0; counter++, dir_sector--)
-            {
-              free_map_release (inode->blocks[counter], 1);
-            }
-          
-          /* L1 INDIRECTION */
-          uint32_t l1_sector = inode_close_indirect_l1 (inode, dir_sector, counter);
-
-          /* L2 INDIRECTION */ 
-          dir_sector = inode_close_indirect_l2 (inode, dir_sector, l1_sector);
-        }
-      /* If not removed, write it to disk */
-      else
-        {
-          /* ref inode_create for similar code */
-          struct inode_disk disk_node;
-          disk_node.magic = INODE_MAGIC;
-          disk_node.length = inode->cur_size;
-          disk_node.cur_index = inode->cur_index;
-          disk_node.l1_index = inode->l1_index;
-          disk_node.l2_index = inode->l2_index;
-          disk_node.is_dir = inode->is_dir;
-
-          /* copy the data (total num of blocks) */
-          memcpy(&disk_node.blocks, &inode->blocks, sizeof(block_sector_t)*NUM_BLOCKS);
-
-          /* Write the struct to fs_device from inode sector*/
-          cache_write (fs_device, inode->sector, &disk_node);
+          /* A file created in this sector later starts from
+             zero counts. */
+          if (inode->cache_stat != NULL)
+            memset (inode->cache_stat, 0, sizeof *inode->cache_stat);
         }
-      free (inode); 
+      /* If not removed, write it to disk if it changed, so that
+         closing a file that was only read logs nothing. */
+      else if (inode->meta_dirty)
+        inode_write_disk (inode);
+      kmem_cache_free (inode_cache, inode); 
     }
 }
 
+/* Releases indirect block SECTOR, which is LEVEL levels above
+   the data, and every sector below it that is not a hole. */
 void
-free_indirect(block_sector_t* sector, int num_ptrs)
+free_indirect (block_sector_t sector, int level)
 {
-  block_sector_t indirect_l1[BLOCK_POINTERS];
+  block_sector_t indirect[BLOCK_POINTERS];
+  int i;
 
-  cache_read(fs_device, *sector, &indirect_l1);
+  if (sector == HOLE)
+    return;
 
-  int tmp_ptrs;
-  for (tmp_ptrs = num_ptrs-1; tmp_ptrs >= 0; tmp_ptrs--)
-    { 
-      free_map_release (indirect_l1[tmp_ptrs], 1);
-    }
+  cache_read (fs_device, sector, &indirect);
+  for (i = 0; i < BLOCK_POINTERS; i++)
+    if (level == 1 && indirect[i] != HOLE)
+      free_map_release (indirect[i], 1);
+    else if (level > 1)
+      free_indirect (indirect[i], level - 1);
 
-  free_map_release (*sector, 1);
+  free_map_release (sector, 1);
 }
 
 /* Marks INODE to be deleted when it is closed by the last caller who
@@ -456,12 +721,13 @@ inode_remove (struct inode *inode)
   inode->removed = true;
 }
 
-/* Gets the chunk size for this inode. */
+/* Gets the chunk size for an access at OFFSET of a file LENGTH
+   bytes long. */
 int
-get_chunk_size (struct inode *inode, off_t size, off_t offset, block_sector_t sector_ofs)
+get_chunk_size (off_t length, off_t size, off_t offset, block_sector_t sector_ofs)
 {
   /* Bytes left in inode, bytes left in sector, lesser of the two. */
-  off_t inode_left = inode_length (inode) - offset;
+  off_t inode_left = length - offset;
   int sector_left = BLOCK_SECTOR_SIZE - sector_ofs;
   int min_left = inode_left < sector_left ? inode_left : sector_left;
 
@@ -480,20 +746,36 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
   off_t bytes_read = 0;
   uint8_t *bounce = NULL;
 
+  inode_read_lock (inode);
+  if (inode->is_inline)
+    {
+      /* INLINE_MAX < BLOCK_SECTOR_SIZE, so one chunk is enough. */
+      bytes_read = get_chunk_size (inode->cur_off, size, offset, 0);
+      if (bytes_read > 0)
+        memcpy (buffer, inode->data + offset, bytes_read);
+      else
+        bytes_read = 0;
+      size = 0;
+    }
   while (size > 0) 
     {
       /* Disk sector to read, starting byte offset within sector. */
       block_sector_t sector_idx = byte_to_sector (inode, offset, 0);
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
-      int chunk_size = get_chunk_size (inode, size, offset, sector_ofs);
+      int chunk_size = get_chunk_size (inode->cur_off, size, offset,
+                                       sector_ofs);
       if (chunk_size <= 0)
         break;
 
       /* Replace with Cache Call */
-      if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
+      if (sector_idx == HOLE)
+        /* A hole reads as zeros without touching the disk. */
+        memset (buffer + bytes_read, 0, chunk_size);
+      else if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
           /* Read full sector directly into caller's buffer. */
-          cache_read (fs_device, sector_idx, buffer + bytes_read);
+          cache_read_owned (fs_device, sector_idx, buffer + bytes_read,
+                            inode->sector, inode->cache_stat);
       else 
         {
           /* Read sector into bounce buffer, then partially copy
@@ -504,7 +786,8 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
               if (bounce == NULL)
                 break;
             }
-          cache_read (fs_device, sector_idx, bounce);
+          cache_read_owned (fs_device, sector_idx, bounce, inode->sector,
+                            inode->cache_stat);
 
           /* Will still need this memcpy */
           memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
@@ -515,11 +798,133 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       offset += chunk_size;
       bytes_read += chunk_size;
     }
+  inode_read_unlock (inode);
   free (bounce);
 
   return bytes_read;
 }
 
+/* Returns the sector holding byte POS of INODE for a write,
+   allocating it first if it is a hole.  Returns -1 if the disk
+   is full. */
+static block_sector_t
+inode_allocate (struct inode *inode, off_t pos)
+{
+  block_sector_t sector;
+
+  inode_write_lock (inode);
+  sector = byte_to_sector (inode, pos, true);
+  if (sector == HOLE)
+    sector = allocate_sector (inode, pos);
+  inode_write_unlock (inode);
+  return sector;
+}
+
+/* Moves the inline data of INODE into a newly allocated data
+   block and turns its union into a block map, unless the disk is
+   full.  The data block is ordered in the journal, so INODE is
+   never committed naming a block whose contents are not on disk.
+   INODE's lock must be held for writing. */
+static void
+inode_uninline (struct inode *inode)
+{
+  uint8_t data[BLOCK_SECTOR_SIZE];
+  block_sector_t sector;
+
+  ASSERT (inode->is_inline);
+
+  memset (data, 0, sizeof data);
+  memcpy (data, inode->data, INLINE_MAX);
+
+  inode->is_inline = false;
+  memset (inode->blocks, 0, sizeof inode->blocks);
+  if (inode->cur_size > 0)
+    {
+      sector = allocate_sector (inode, 0);
+      if (sector == (block_sector_t) -1)
+        {
+          /* Disk full: stay inline. */
+          memcpy (inode->data, data, INLINE_MAX);
+          inode->is_inline = true;
+          return;
+        }
+      write_sector (inode, sector, data);
+    }
+  inode_write_disk (inode);
+}
+
+/* Reserves room in INODE for a write that ends at LENGTH, if it
+   is past the reserved end of file, first moving INODE's data
+   out of line if it will no longer fit there.  An inline inode
+   that still fits needs no reservation.  Reserving allocates
+   nothing: the range is a hole until written.  Returns true if
+   the file was extended, in which case the caller must call
+   inode_publish() once it has written the data. */
+static bool
+inode_extend (struct inode *inode, off_t length)
+{
+  bool extended = false;
+
+  if (length > inode->cur_size)
+    {
+      inode_write_lock (inode);
+      if (inode->is_inline && (size_t) length > INLINE_MAX)
+        inode_uninline (inode);
+      if (!inode->is_inline && length > inode->cur_size)
+        {
+          inode->cur_size = length < MAX_LENGTH ? length : MAX_LENGTH;
+          inode->extend_cnt++;
+          inode->meta_dirty = true;
+          extended = true;
+        }
+      inode_write_unlock (inode);
+    }
+  return extended;
+}
+
+/* Ends an extension of INODE begun by inode_extend().  When the
+   last extension in flight ends, every reserved range has been
+   written, so readers may see all of it. */
+static void
+inode_publish (struct inode *inode)
+{
+  inode_write_lock (inode);
+  ASSERT (inode->extend_cnt > 0);
+  if (--inode->extend_cnt == 0)
+    inode->cur_off = inode->cur_size;
+  inode_write_unlock (inode);
+}
+
+/* Writes SIZE bytes from BUFFER into inline INODE at OFFSET,
+   growing it if the write ends past its end.  Returns false,
+   writing nothing, if INODE is not inline or the write would end
+   past INLINE_MAX bytes.  Metadata goes to the journal at once;
+   a file's data reaches disk with its inode, on close or sync. */
+static bool
+inode_write_inline (struct inode *inode, const void *buffer, off_t size,
+                    off_t offset)
+{
+  bool done = false;
+
+  if (!inode->is_inline || (size_t) (offset + size) > INLINE_MAX)
+    return false;
+
+  inode_write_lock (inode);
+  if (inode->is_inline)
+    {
+      memcpy (inode->data + offset, buffer, size);
+      if (offset + size > inode->cur_size)
+        inode->cur_size = inode->cur_off = offset + size;
+      if (inode_is_metadata (inode))
+        inode_write_disk (inode);
+      else
+        inode->meta_dirty = true;
+      done = true;
+    }
+  inode_write_unlock (inode);
+  return done;
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
    less than SIZE if end of file is reached or an error occurs.
@@ -532,23 +937,20 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
   uint8_t *bounce = NULL;
+  bool extended;
 
   if (inode->deny_write_cnt)
     return 0;
+  if (inode_write_inline (inode, buffer, size, offset))
+    return size;
 
-  /* Need to extend the file for a write */
-  /* b/c offset is past end of file */
-  if (offset + size > inode->cur_size)
-    {
-      if (!inode->is_dir)
-        lock_acquire (&(inode->inode_lock));
-      uint32_t new_len = file_ext (inode, offset+size);
-
-      if (!inode->is_dir)
-        lock_release (&(inode->inode_lock));
-      inode->cur_size = new_len;
-    }
+  extended = inode_extend (inode, offset + size);
 
+  /* Writing data into allocated sectors does not change the block
+     map, so writers only need to keep it from being extended
+     under them.  Filling a hole does, so it takes the lock for
+     writing. */
+  inode_read_lock (inode);
   while (size > 0) 
     {
       /* Sector to write, starting byte offset within sector. */
@@ -556,14 +958,23 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Number of bytes to actually write into this sector. */
-      int chunk_size = get_chunk_size (inode, size, offset, sector_ofs);
+      int chunk_size = get_chunk_size (inode->cur_size, size, offset,
+                                       sector_ofs);
       if (chunk_size <= 0)
         break;
+      if (sector_idx == HOLE)
+        {
+          inode_read_unlock (inode);
+          sector_idx = inode_allocate (inode, offset);
+          inode_read_lock (inode);
+        }
+      if (sector_idx == (block_sector_t) -1)
+        break;
 
       /* Replace with Cache */
       if (sector_ofs == 0 && chunk_size == BLOCK_SECTOR_SIZE)
           /* Write full sector directly to disk. */
-          cache_write (fs_device, sector_idx, buffer + bytes_written);
+          write_sector (inode, sector_idx, buffer + bytes_written);
       else 
         {
           /* We need a bounce buffer. */
@@ -578,11 +989,12 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
              we're writing, then we need to read in the sector
              first.  Otherwise we start with a sector of all zeros. */
           if (sector_ofs > 0 || chunk_size < (BLOCK_SECTOR_SIZE - sector_ofs)) 
-            cache_read (fs_device, sector_idx, bounce);
+            cache_read_owned (fs_device, sector_idx, bounce,
+                              inode->sector, inode->cache_stat);
           else
             memset (bounce, 0, BLOCK_SECTOR_SIZE);
           memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-          cache_write (fs_device, sector_idx, bounce);
+          write_sector (inode, sector_idx, bounce);
         }
 
       /* Advance. */
@@ -590,12 +1002,170 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       offset += chunk_size;
       bytes_written += chunk_size;
     }
-  inode->cur_off = inode_length (inode);
+  inode_read_unlock (inode);
+  if (extended)
+    inode_publish (inode);
   free (bounce);
 
   return bytes_written;
 }
 
+/* Copies SIZE bytes from SRC starting at SRC_OFS into DST
+   starting at DST_OFS, extending DST as needed.  Whole sectors
+   that line up in both files are copied cache entry to cache
+   entry with cache_copy(); only partial sectors at unaligned
+   edges go through a bounce buffer.  Returns the number of bytes
+   copied, which may be less than SIZE if end of SRC is reached,
+   writes to DST are denied, or an error occurs, or -1 if SRC and
+   DST are the same inode and the two ranges overlap, since
+   copying forward would overwrite source bytes before reading
+   them. */
+off_t
+inode_copy_range (struct inode *src, off_t src_ofs,
+                  struct inode *dst, off_t dst_ofs, off_t size)
+{
+  off_t bytes_copied = 0;
+  uint8_t *bounce = NULL;
+  bool extended;
+
+  if (dst->deny_write_cnt || src_ofs >= inode_length (src))
+    return 0;
+  if (size > inode_length (src) - src_ofs)
+    size = inode_length (src) - src_ofs;
+  if (src == dst && src_ofs < dst_ofs + size && dst_ofs < src_ofs + size)
+    return -1;
+
+  extended = inode_extend (dst, dst_ofs + size);
+
+  while (size > 0)
+    {
+      /* Starting byte offsets within the source and destination
+         sectors; the chunk ends at whichever sector ends first. */
+      int src_sector_ofs = src_ofs % BLOCK_SECTOR_SIZE;
+      int dst_sector_ofs = dst_ofs % BLOCK_SECTOR_SIZE;
+      int max_ofs = src_sector_ofs > dst_sector_ofs ? src_sector_ofs
+                                                    : dst_sector_ofs;
+      int chunk_size = BLOCK_SECTOR_SIZE - max_ofs;
+      if (chunk_size > size)
+        chunk_size = size;
+
+      if (chunk_size == BLOCK_SECTOR_SIZE)
+        {
+          /* SRC and DST may be the same inode, so look each
+             sector up under its own lock. */
+          block_sector_t src_sector, dst_sector;
+
+          inode_read_lock (src);
+          src_sector = byte_to_sector (src, src_ofs, 0);
+          inode_read_unlock (src);
+          inode_read_lock (dst);
+          dst_sector = byte_to_sector (dst, dst_ofs, 1);
+          inode_read_unlock (dst);
+
+          /* A hole copies as a hole, or as zeros over data. */
+          if (src_sector != HOLE && dst_sector == HOLE)
+            dst_sector = inode_allocate (dst, dst_ofs);
+          if (dst_sector == (block_sector_t) -1)
+            break;
+          if (src_sector != HOLE)
+            cache_copy (fs_device, dst_sector, src_sector, dst->sector,
+                        dst->cache_stat);
+          else if (dst_sector != HOLE)
+            write_sector (dst, dst_sector, zeros);
+        }
+      else
+        {
+          if (bounce == NULL)
+            {
+              bounce = malloc (BLOCK_SECTOR_SIZE);
+              if (bounce == NULL)
+                break;
+            }
+          if (inode_read_at (src, bounce, chunk_size, src_ofs) != chunk_size
+              || inode_write_at (dst, bounce, chunk_size, dst_ofs)
+                 != chunk_size)
+            break;
+        }
+
+      /* Advance. */
+      size -= chunk_size;
+      src_ofs += chunk_size;
+      dst_ofs += chunk_size;
+      bytes_copied += chunk_size;
+    }
+  if (extended)
+    inode_publish (dst);
+  free (bounce);
+
+  return bytes_copied;
+}
+
+/* Allocates sectors for every hole in the first LENGTH bytes of
+   INODE and extends it to LENGTH bytes if it is shorter, so that
+   writes there will not need to allocate.  The new sectors are
+   reserved as one run first, if the free map has one.  Returns
+   true if successful, false if writes to INODE are denied,
+   LENGTH is too long, or the disk is full, in which case some
+   sectors may still have been allocated. */
+bool
+inode_allocate_range (struct inode *inode, off_t length)
+{
+  bool success = (!inode->deny_write_cnt && length >= 0
+                  && length <= MAX_LENGTH);
+  off_t pos;
+
+  if (!success)
+    return false;
+
+  inode_write_lock (inode);
+  if (inode->is_inline && (size_t) length > INLINE_MAX)
+    inode_uninline (inode);
+  if (!inode->is_inline)
+    {
+      if (length > inode->cur_size)
+        {
+          prealloc_trim (inode);
+          prealloc (inode, bytes_to_sectors (length)
+                           - bytes_to_sectors (inode->cur_size));
+        }
+      for (pos = 0; pos < length && success; pos += BLOCK_SECTOR_SIZE)
+        if (lookup_sector (inode, pos) == HOLE)
+          success = allocate_sector (inode, pos) != (block_sector_t) -1;
+    }
+  else if ((size_t) length > INLINE_MAX)
+    success = false;
+
+  if (success && length > inode->cur_size)
+    {
+      /* Appends in flight publish the new length when they end. */
+      inode->cur_size = length;
+      if (inode->extend_cnt == 0)
+        inode->cur_off = length;
+      inode->meta_dirty = true;
+    }
+  inode_write_unlock (inode);
+  return success;
+}
+
+/* Makes INODE durable.  Writes its dirty data sectors from the
+   buffer cache to disk in sector order.  Then, unless DATA_ONLY
+   is true and INODE has not grown since it was last written,
+   writes INODE itself and commits the journal, which makes its
+   block map and the free map durable too.  Other files' dirty
+   data stays in the cache. */
+void
+inode_sync (struct inode *inode, bool data_only)
+{
+  cache_flush_owner (inode->sector);
+  if (!data_only || inode->meta_dirty)
+    {
+      inode_write_lock (inode);
+      inode_write_disk (inode);
+      inode_write_unlock (inode);
+      journal_flush ();
+    }
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
@@ -616,174 +1186,171 @@ inode_allow_write (struct inode *inode)
   inode->deny_write_cnt--;
 }
 
-/* Returns the length, in bytes, of INODE's data. */
+/* Returns the length, in bytes, of INODE's data that has been
+   written.  Ranges still being appended are not included. */
 off_t
 inode_length (const struct inode *inode)
 {
-  return inode->cur_size;
+  return inode->cur_off;
 }
 
-/* Finds file_ext for direct blocks/ */
-uint32_t
-file_ext_direct (struct inode* inode, uint32_t size_to_add) 
+int
+inode_cnt (const struct inode *inode)
 {
-  /* buffer we use for block write's, size of 1 block */
-  static char dir_buf[BLOCK_SECTOR_SIZE];
-  /* Fills up all the direct blocks */
-  for (;inode->cur_index < NUMBER_DIRECT; size_to_add--, inode->cur_index++)
-    {
-      if (size_to_add == 0) 
-        return size_to_add;
-
-      /* Alloc 1 sector */
-      free_map_allocate (1, &inode->blocks[inode->cur_index]);
-      cache_write (fs_device, inode->blocks[inode->cur_index], dir_buf);
-    }
-  return size_to_add;
+  return inode->open_cnt;
 }
 
-/* Finds file_ext for l1 indirect blocks. */
-uint32_t
-file_ext_indirect_l1 (struct inode* inode, uint32_t size_to_add)
+/* Locks directory INODE for a change to its entries. */
+void
+dir_lock (struct inode *inode)
 {
-  /* Fill up the indirect block (at l1 indirect, and not too large)*/
-  if (inode->cur_index == L1_PLACE && size_to_add != 0) 
-    {
-      block_sector_t indirect_l1[BLOCK_POINTERS];
-
-      if (inode->l1_index != 0) 
-        /* grab the ptrs for l1 and put them in indirect l1 */
-        cache_read (fs_device, inode->blocks[L1_PLACE], &indirect_l1);
-
-      else
-        /* alloc the indirect L1 block */
-        free_map_allocate (1, &inode->blocks[L1_PLACE]);
-
-      static char ind_buff[BLOCK_SECTOR_SIZE];
-      /* populate the blocks */
-      for (; inode->l1_index < BLOCK_POINTERS && size_to_add > 0; size_to_add--, inode->l1_index++)
-        {
-          /* Alloc 1 sector, sub off 100 (num direct) since it's the total index and need relatvie */
-          free_map_allocate (1, &indirect_l1[inode->l1_index]);
-          cache_write (fs_device, indirect_l1[inode->l1_index], ind_buff);
-        }
-
-      /* If we're out of l1 ptrs, set cur to l2 and l1 back to 0 */
-      if (inode->l1_index == BLOCK_POINTERS) 
-        {
-          inode->cur_index++;
-          inode->l1_index = 0;
-        }
-
-      /* write the block to the blocks array */
-      cache_write (fs_device, inode->blocks[L1_PLACE], &indirect_l1);
-    }
-  return size_to_add;
+  rwlock_acquire_write (&inode->inode_lock);
 }
 
-/* Finds file_ext for l2 indirect blocks. */
-uint32_t
-file_ext_indirect_l2 (struct inode* inode, uint32_t size_to_add)
+/* Releases the lock taken by dir_lock(). */
+void
+dir_unlock (struct inode *inode)
 {
-  /* max value is total num of ptrs */
-  if (inode->cur_index == L2_PLACE && size_to_add != 0)
-    {
-      block_sector_t indirect_l2[BLOCK_POINTERS];
-
-      /* direct+indirect ptrs */
-      if (inode->l1_index != 0 || inode->l2_index != 0) 
-        /* grab the ptrs for l1 and put them in indirect l1 */
-        cache_read (fs_device, inode->blocks[L2_PLACE], &indirect_l2);
-
-      else
-        /* alloc the indirect L1 block */
-        free_map_allocate (1, &inode->blocks[L2_PLACE]);
-
-      /* Will go through the 128 indirect blocks this holds */
-      while (inode->l1_index < BLOCK_POINTERS && size_to_add != 0)
-        {
-          block_sector_t inner_indirect_l2[BLOCK_POINTERS];
-
-          if (inode->l2_index != 0)
-            cache_read (fs_device, indirect_l2[inode->l1_index], &inner_indirect_l2);
+  rwlock_release_write (&inode->inode_lock);
+}
 
-          else  
-            free_map_allocate (1, &indirect_l2[inode->l1_index]);
+/* Locks directory INODE for reading its entries.  Any number of
+   threads may read a directory at once. */
+void
+dir_read_lock (struct inode *inode)
+{
+  rwlock_acquire_read (&inode->inode_lock);
+}
 
-          static char ind_l2_buff[BLOCK_SECTOR_SIZE];
-          for (; inode->l2_index < BLOCK_POINTERS && size_to_add > 0; size_to_add--, inode->l2_index++)
-            {
-              free_map_allocate (1, &inner_indirect_l2[inode->l2_index]);
-              cache_write (fs_device, inner_indirect_l2[inode->l2_index], ind_l2_buff);
-            }
+/* Releases the lock taken by dir_read_lock(). */
+void
+dir_read_unlock (struct inode *inode)
+{
+  rwlock_release_read (&inode->inode_lock);
+}
 
-          /* write the block to the blocks array */
-          cache_write (fs_device, indirect_l2[inode->l1_index], &inner_indirect_l2);
-        
-          /* If we're out of l1 ptrs, set cur to l2 and l1 back to 0 */
-          if (inode->l1_index == BLOCK_POINTERS) 
-            {
-              inode->l1_index++;
-              inode->l2_index = 0;
-            }
-        }
+/* Returns true if every sector holding the SIZE bytes of INODE
+   that start at OFFSET is currently in the buffer cache. */
+bool
+inode_is_cached (const struct inode *inode, off_t offset, off_t size)
+{
+  off_t pos;
 
-      /* write the indirect l2 to the blocks, cur_indx should be 101*/
-      cache_write (fs_device, inode->blocks[inode->cur_index], &indirect_l2);
+  if (inode->is_inline)
+    return true;
+  for (pos = offset - offset % BLOCK_SECTOR_SIZE; pos < offset + size;
+       pos += BLOCK_SECTOR_SIZE)
+    {
+      block_sector_t sector = byte_to_sector (inode, pos, 0);
+      if (sector == (block_sector_t) -1
+          || (sector != HOLE
+              && find_block_in_cache (fs_device, sector) == NULL))
+        return false;
     }
-  return size_to_add;
+  return true;
 }
 
-/* This will return the new length and take in an inode and requested length
- * Will need to do some crazy f**king indirect computation. Probably need a few helpers for the indirection
- */
-uint32_t
-file_ext (struct inode* inode, uint32_t new_size) 
+/* Returns true if the inode in SECTOR is a directory.  Reads the
+   inode through the cache without opening it, so that listing a
+   directory does not open and write back every inode in it. */
+bool
+inode_sector_is_dir (block_sector_t sector)
 {
-  uint32_t size_to_add = new_space (inode, new_size);
+  struct inode_disk data;
 
-  /* DIRECT */
-  size_to_add = file_ext_direct (inode, size_to_add);
-  if (size_to_add == 0)
-    return new_size;
+  cache_read (fs_device, sector, &data);
+  return data.is_dir;
+}
 
-  /* SINGLE INDIRECT */
-  size_to_add = file_ext_indirect_l1 (inode, size_to_add);
+/* Returns the number of sectors used by indirect block SECTOR,
+   which is LEVEL levels above the data, and by the sectors below
+   it. */
+static size_t
+count_indirect (block_sector_t sector, int level)
+{
+  block_sector_t indirect[BLOCK_POINTERS];
+  size_t cnt = 1;
+  int i;
 
-  /* DOUBLE INDIRECT */
-  size_to_add = file_ext_indirect_l2 (inode, size_to_add);
+  if (sector == HOLE)
+    return 0;
 
-  /* return new_size if we were able to add all the data */
-  if (size_to_add == 0) 
-    return new_size;
-  else
-    return new_size - (size_to_add * BLOCK_SECTOR_SIZE);
+  cache_read (fs_device, sector, &indirect);
+  for (i = 0; i < BLOCK_POINTERS; i++)
+    if (level == 1)
+      cnt += indirect[i] != HOLE;
+    else
+      cnt += count_indirect (indirect[i], level - 1);
+  return cnt;
 }
 
-uint32_t 
-new_space (struct inode* inode, uint32_t new_size) 
+/* Returns the number of sectors used by block map BLOCKS, not
+   counting the inode sector itself. */
+static size_t
+count_blocks (const block_sector_t blocks[NUM_BLOCKS])
 {
-  uint32_t new_len = (new_size + (BLOCK_SECTOR_SIZE - 1)) / BLOCK_SECTOR_SIZE;
-  uint32_t old_len = (inode->cur_size + (BLOCK_SECTOR_SIZE - 1)) / BLOCK_SECTOR_SIZE;
-  return new_len - old_len;
-}
+  size_t cnt = 0;
+  int i;
 
-int
-inode_cnt (const struct inode *inode)
-{
-  return inode->open_cnt;
+  for (i = 0; i < NUMBER_DIRECT; i++)
+    cnt += blocks[i] != HOLE;
+  return (cnt + count_indirect (blocks[L1_PLACE], 1)
+          + count_indirect (blocks[L2_PLACE], 2));
 }
 
-void
-dir_lock (struct inode *inode)
+/* Fills ST with the attributes of the inode in SECTOR without
+   opening it.  If the inode is open, its in-memory length and
+   block map are used, since they may be ahead of the disk.
+   Returns false if SECTOR does not hold an inode.  The caller
+   must keep the inode from being freed meanwhile, by holding it
+   open or by holding the lock of a directory that names it. */
+bool
+inode_stat (block_sector_t sector, struct stat *st)
 {
-  lock_acquire (&(inode->inode_lock));
+  struct list_elem *e;
+  struct inode *inode = NULL;
+
+  lock_acquire (&open_inodes_lock);
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e))
+    if (list_entry (e, struct inode, elem)->sector == sector)
+      {
+        inode = list_entry (e, struct inode, elem);
+        inode->open_cnt++;
+        break;
+      }
+  lock_release (&open_inodes_lock);
+
+  st->inumber = sector;
+  if (inode != NULL)
+    {
+      rwlock_acquire_read (&inode->inode_lock);
+      st->length = inode->cur_off;
+      st->is_dir = inode->is_dir;
+      st->blocks = inode->is_inline ? 0 : count_blocks (inode->blocks);
+      rwlock_release_read (&inode->inode_lock);
+      inode_close (inode);
+    }
+  else
+    {
+      struct inode_disk data;
+
+      cache_read (fs_device, sector, &data);
+      if (data.magic != INODE_MAGIC)
+        return false;
+      st->length = data.length;
+      st->is_dir = data.is_dir;
+      st->blocks = data.is_inline ? 0 : count_blocks (data.blocks);
+    }
+  return true;
 }
 
-void
-dir_unlock (struct inode *inode)
+/* Returns INODE's buffer cache counts, or a null pointer if there
+   was no memory to keep them. */
+const struct cache_stat *
+inode_cache_stat (const struct inode *inode)
 {
-  lock_release (&(inode->inode_lock));
+  return inode->cache_stat;
 }
 
 /* Returns is_dir of INODE's data. 0: file, 1: directory. */
@@ -6,6 +6,8 @@
 #include "devices/block.h"
 
 struct bitmap;
+struct stat;
+struct cache_stat;
 
 void inode_init (void);
 bool inode_create (block_sector_t, off_t, int is_dir);
@@ -16,14 +18,24 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_copy_range (struct inode *src, off_t src_ofs,
+                        struct inode *dst, off_t dst_ofs, off_t size);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
 int inode_cnt (const struct inode *);
+bool inode_is_cached (const struct inode *, off_t offset, off_t size);
+void inode_sync (struct inode *, bool data_only);
+bool inode_allocate_range (struct inode *, off_t length);
 
 void dir_lock (struct inode *inode);
 void dir_unlock (struct inode *inode);
+void dir_read_lock (struct inode *inode);
+void dir_read_unlock (struct inode *inode);
 
 int inode_isdir (const struct inode *);
+bool inode_sector_is_dir (block_sector_t);
+bool inode_stat (block_sector_t, struct stat *);
+const struct cache_stat *inode_cache_stat (const struct inode *);
 
 #endif /* filesys/inode.h */
@@ -0,0 +1,395 @@
+#include "filesys/journal.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "filesys/cache.h"
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Write-ahead journal for file system metadata.
+
+   Inode sectors, indirect blocks, directory contents and the
+   free map are written through journal_write() instead of
+   straight to the buffer cache.  Each such sector is pinned in
+   the cache as part of the running "group", and is neither
+   evicted nor written home until the group commits.  Committing
+   writes a copy of every sector in the group to the journal area
+   one after another, then the journal header, which names each
+   copy's home sector.  Writing the header is the commit point:
+   once it is on disk, the group is replayed by journal_init() if
+   the system stops before the sectors reach their homes.  Then
+   the sectors are written home and the header is cleared.
+
+   Each system call that changes the file system runs as one
+   transaction, between journal_begin() and journal_end().  Many
+   transactions share one group, so a burst of creates costs one
+   sequential journal write instead of several scattered writes
+   apiece.  A group commits once it holds JOURNAL_GROUP sectors
+   or is JOURNAL_AGE ticks old, as soon as no transaction is
+   running; new transactions wait while a commit is pending so
+   that the running ones drain.  Age is checked when a
+   transaction ends and by a background thread every JOURNAL_AGE
+   ticks, so a group left behind when the system goes idle still
+   commits within about twice that.  A group never outgrows the
+   journal: a write that would put more than JOURNAL_MAX sectors
+   in the group commits the group on the spot, without waiting
+   for the running transactions to end, since the writer may hold
+   locks they need.  Such a forced commit makes durable the part
+   of every running transaction that has been logged so far, not
+   just the part of the transaction that filled the group, so a
+   crash after it may leave any of those transactions half done.
+   It happens only when the transactions running at once log
+   more than JOURNAL_MAX sectors between them, e.g. a large
+   copy_file_range() or fallocate(); the statistics count it.
+
+   File data is not journaled, but a data sector newly allocated
+   to a file is "ordered" with journal_order(): it is written
+   back from the cache before the group that may hold a pointer
+   to it commits, so that a committed block map never names a
+   sector that still holds a freed file's old bytes on disk.  At
+   most ORDERED_MAX sectors wait for a commit; more are written
+   back early. */
+
+/* Most sectors in one group. */
+#define JOURNAL_MAX (JOURNAL_SECTORS - 1)
+
+/* Group size at which the group commits. */
+#define JOURNAL_GROUP 16
+
+/* Age in timer ticks at which a group commits. */
+#define JOURNAL_AGE TIMER_FREQ
+
+/* Most data sectors ordered before a commit. */
+#define ORDERED_MAX 64
+
+/* Identifies a journal header. */
+#define JOURNAL_MAGIC 0x4a524e4c
+
+/* On-disk journal header.
+   Must be exactly BLOCK_SECTOR_SIZE bytes long. */
+struct journal_header
+  {
+    uint32_t magic;                     /* JOURNAL_MAGIC. */
+    uint32_t seq;                       /* Group sequence number. */
+    uint32_t cnt;                       /* Committed sectors, 0 if none. */
+    block_sector_t homes[JOURNAL_MAX];  /* Home of each logged copy. */
+    uint8_t unused[BLOCK_SECTOR_SIZE - 12
+                   - JOURNAL_MAX * sizeof (block_sector_t)];
+  };
+
+static struct lock journal_lock;        /* Protects everything below. */
+static struct condition commit_done;    /* Signaled after each commit. */
+static bool journal_ready;              /* journal_init() has run. */
+
+/* The running group. */
+static struct cache_entry *group[JOURNAL_MAX];  /* Logged entries. */
+static size_t group_cnt;                /* Number of logged entries. */
+static int64_t group_start;             /* Tick the group started. */
+static uint32_t group_seq;              /* Sequence number. */
+
+/* Data sectors to write back before the running group commits. */
+static block_sector_t ordered[ORDERED_MAX];
+static size_t ordered_cnt;
+
+static int active_cnt;                  /* Running transactions. */
+static bool commit_pending;             /* Commit waits for drain. */
+
+/* Statistics. */
+static unsigned long long txn_cnt;      /* Transactions. */
+static unsigned long long commit_cnt;   /* Groups committed. */
+static unsigned long long logged_cnt;   /* Sectors committed. */
+static unsigned long long forced_cnt;   /* Commits of a full group while
+                                           transactions ran. */
+
+static thread_func commit_daemon NO_RETURN;
+static void maybe_commit (void);
+static void commit (void);
+static void write_ordered (void);
+static void write_header (uint32_t cnt, const block_sector_t *homes);
+
+/* Initializes the journal.  If FORMAT is true, clears the journal
+   area; otherwise replays the group committed last, if it did not
+   reach its home sectors before the system stopped.  Must be
+   called before any metadata is read. */
+void
+journal_init (bool format)
+{
+  ASSERT (sizeof (struct journal_header) == BLOCK_SECTOR_SIZE);
+
+  lock_init (&journal_lock);
+  cond_init (&commit_done);
+
+  if (format)
+    write_header (0, NULL);
+  else
+    {
+      static struct journal_header h;
+      static uint8_t copy[BLOCK_SECTOR_SIZE];
+      uint32_t i;
+
+      block_read (fs_device, JOURNAL_SECTOR, &h);
+      if (h.magic != JOURNAL_MAGIC || h.cnt > JOURNAL_MAX)
+        PANIC ("journal header is corrupt; reformat the file system");
+      group_seq = h.seq + 1;
+      if (h.cnt > 0)
+        {
+          printf ("journal: replaying %"PRIu32" sectors of group %"PRIu32"\n",
+                  h.cnt, h.seq);
+          for (i = 0; i < h.cnt; i++)
+            {
+              block_read (fs_device, JOURNAL_SECTOR + 1 + i, copy);
+              block_write (fs_device, h.homes[i], copy);
+            }
+          write_header (0, NULL);
+        }
+    }
+
+  journal_ready = true;
+  if (thread_create ("journal", PRI_DEFAULT, commit_daemon, NULL)
+      == TID_ERROR)
+    PANIC ("cannot start the journal commit thread");
+}
+
+/* Begins a transaction.  Transactions nest; only the outermost
+   one counts. */
+void
+journal_begin (void)
+{
+  struct thread *cur = thread_current ();
+
+  if (!journal_ready || cur->journal_depth++ > 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  while (commit_pending)
+    cond_wait (&commit_done, &journal_lock);
+  active_cnt++;
+  txn_cnt++;
+  lock_release (&journal_lock);
+}
+
+/* Ends the transaction begun by the matching journal_begin().
+   The last transaction to end commits the group if it is full or
+   old enough, or if a commit is pending. */
+void
+journal_end (void)
+{
+  struct thread *cur = thread_current ();
+
+  if (!journal_ready)
+    return;
+  ASSERT (cur->journal_depth > 0);
+  if (--cur->journal_depth > 0)
+    return;
+
+  lock_acquire (&journal_lock);
+  ASSERT (active_cnt > 0);
+  active_cnt--;
+  maybe_commit ();
+  lock_release (&journal_lock);
+}
+
+/* Ends any transaction the current thread left open, because it
+   was killed in the middle of a system call. */
+void
+journal_exit (void)
+{
+  struct thread *cur = thread_current ();
+
+  if (cur->journal_depth > 0)
+    {
+      cur->journal_depth = 1;
+      journal_end ();
+    }
+}
+
+/* Writes metadata BUFFER to SECTOR of the file system device as
+   part of the current transaction.  A write outside of any
+   transaction is a transaction of its own.  It does not wait for
+   a pending commit, because its caller may hold locks that the
+   running transactions need. */
+void
+journal_write (block_sector_t sector, const void *buffer)
+{
+  struct cache_entry *entry;
+  bool newly_logged;
+
+  if (!journal_ready)
+    {
+      cache_write (fs_device, sector, buffer);
+      return;
+    }
+
+  lock_acquire (&journal_lock);
+
+  /* Make room if SECTOR is not already in the group.  Entries
+     are only logged or unlogged under journal_lock, so the
+     answer cannot change before cache_log(). */
+  entry = find_block_in_cache (fs_device, sector);
+  if (group_cnt == JOURNAL_MAX && (entry == NULL || !entry->logged))
+    {
+      /* Forced commit: also commits what other running
+         transactions have logged so far.  See the top of this
+         file. */
+      forced_cnt++;
+      commit ();
+    }
+  if (group_cnt == 0)
+    group_start = timer_ticks ();
+
+  entry = cache_log (fs_device, sector, buffer, &newly_logged);
+  if (newly_logged)
+    group[group_cnt++] = entry;
+
+  if (thread_current ()->journal_depth == 0)
+    {
+      txn_cnt++;
+      maybe_commit ();
+    }
+  lock_release (&journal_lock);
+}
+
+/* Makes SECTOR, a data sector just allocated to a file, reach
+   disk from the buffer cache before any group that can name it
+   commits. */
+void
+journal_order (block_sector_t sector)
+{
+  if (!journal_ready)
+    return;
+
+  lock_acquire (&journal_lock);
+  if (ordered_cnt == ORDERED_MAX)
+    write_ordered ();
+  ordered[ordered_cnt++] = sector;
+  lock_release (&journal_lock);
+}
+
+/* Commits the running group now, waiting for running
+   transactions to end first.  Must not be called inside a
+   transaction. */
+void
+journal_flush (void)
+{
+  if (!journal_ready)
+    return;
+  ASSERT (thread_current ()->journal_depth == 0);
+
+  lock_acquire (&journal_lock);
+  if (group_cnt > 0)
+    {
+      commit_pending = true;
+      while (active_cnt > 0)
+        cond_wait (&commit_done, &journal_lock);
+      if (group_cnt > 0)
+        commit ();
+    }
+  lock_release (&journal_lock);
+}
+
+/* Prints journal statistics. */
+void
+journal_print_stats (void)
+{
+  printf ("Journal: %llu transactions, %llu commits (%llu forced), "
+          "%llu sectors logged\n",
+          txn_cnt, commit_cnt, forced_cnt, logged_cnt);
+}
+
+/* Commits the running group whenever it has grown old, even if
+   no transaction ends to notice. */
+static void
+commit_daemon (void *aux UNUSED)
+{
+  for (;;)
+    {
+      timer_sleep (JOURNAL_AGE);
+      lock_acquire (&journal_lock);
+      maybe_commit ();
+      lock_release (&journal_lock);
+    }
+}
+
+/* Commits the running group if it is full or old enough, once
+   no transaction is running.  Until then, makes new transactions
+   wait so that the running ones drain.  journal_lock must be
+   held. */
+static void
+maybe_commit (void)
+{
+  if (group_cnt >= JOURNAL_GROUP
+      || (group_cnt > 0 && timer_elapsed (group_start) >= JOURNAL_AGE))
+    commit_pending = true;
+  if (commit_pending && active_cnt == 0)
+    commit ();
+}
+
+/* Commits the running group: writes its sectors to the journal,
+   commits by writing the header, checkpoints the sectors to
+   their homes, and clears the header.  Wakes up threads waiting
+   for the commit.  journal_lock must be held. */
+static void
+commit (void)
+{
+  block_sector_t homes[JOURNAL_MAX];
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+
+  if (group_cnt > 0)
+    {
+      write_ordered ();
+      for (i = 0; i < group_cnt; i++)
+        {
+          homes[i] = group[i]->sector;
+          block_write (fs_device, JOURNAL_SECTOR + 1 + i, group[i]->data);
+        }
+      write_header (group_cnt, homes);
+
+      for (i = 0; i < group_cnt; i++)
+        cache_checkpoint (group[i]);
+      write_header (0, NULL);
+
+      commit_cnt++;
+      logged_cnt += group_cnt;
+      group_cnt = 0;
+      group_seq++;
+    }
+
+  commit_pending = false;
+  cond_broadcast (&commit_done, &journal_lock);
+}
+
+/* Writes the ordered data sectors back from the cache and
+   forgets them.  journal_lock must be held. */
+static void
+write_ordered (void)
+{
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&journal_lock));
+
+  for (i = 0; i < ordered_cnt; i++)
+    cache_write_back (fs_device, ordered[i]);
+  ordered_cnt = 0;
+}
+
+/* Writes the journal header, naming the CNT home sectors in
+   HOMES. */
+static void
+write_header (uint32_t cnt, const block_sector_t *homes)
+{
+  static struct journal_header h;
+
+  memset (&h, 0, sizeof h);
+  h.magic = JOURNAL_MAGIC;
+  h.seq = group_seq;
+  h.cnt = cnt;
+  if (cnt > 0)
+    memcpy (h.homes, homes, cnt * sizeof *homes);
+  block_write (fs_device, JOURNAL_SECTOR, &h);
+}
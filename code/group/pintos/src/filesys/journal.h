@@ -0,0 +1,21 @@
+#ifndef FILESYS_JOURNAL_H
+#define FILESYS_JOURNAL_H
+
+#include <stdbool.h>
+#include "devices/block.h"
+
+/* Sectors reserved for the journal, right after the root
+   directory's inode. */
+#define JOURNAL_SECTOR 2        /* Journal header sector. */
+#define JOURNAL_SECTORS 49      /* Header plus logged sector copies. */
+
+void journal_init (bool format);
+void journal_begin (void);
+void journal_end (void);
+void journal_exit (void);
+void journal_write (block_sector_t, const void *);
+void journal_order (block_sector_t);
+void journal_flush (void);
+void journal_print_stats (void);
+
+#endif /* filesys/journal.h */
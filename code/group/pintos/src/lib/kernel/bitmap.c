@@ -69,6 +69,58 @@ last_mask (const struct bitmap *b)
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns a mask of the bits in an element from bit OFS
+   (inclusive) to bit OFS + CNT (exclusive).  OFS must be less
+   than ELEM_BITS and OFS + CNT at most ELEM_BITS. */
+static inline elem_type
+range_mask (size_t ofs, size_t cnt)
+{
+  elem_type mask = cnt < ELEM_BITS ? ((elem_type) 1 << cnt) - 1 : (elem_type) -1;
+  return mask << ofs;
+}
+
+/* Returns element IDX of B, inverted if VALUE is false, so that
+   bits equal to VALUE read as 1. */
+static inline elem_type
+elem_match (const struct bitmap *b, size_t idx, bool value)
+{
+  return value ? b->bits[idx] : ~b->bits[idx];
+}
+
+/* Returns the index of the lowest set bit in nonzero ELEM. */
+static inline size_t
+first_set (elem_type elem)
+{
+  return __builtin_ctzl (elem);
+}
+
+/* Returns the index of the first bit in B at or after START and
+   before END that is set to VALUE, or END if there is none.
+   Looks at a whole element at a time, so runs of bits that are
+   all !VALUE are skipped ELEM_BITS at once. */
+static size_t
+next_bit (const struct bitmap *b, size_t start, size_t end, bool value)
+{
+  size_t idx, last_idx;
+  elem_type elem;
+
+  if (start >= end)
+    return end;
+
+  idx = elem_idx (start);
+  last_idx = elem_idx (end - 1);
+  elem = elem_match (b, idx, value) & ((elem_type) -1 << (start % ELEM_BITS));
+  while (elem == 0)
+    {
+      if (++idx > last_idx)
+        return end;
+      elem = elem_match (b, idx, value);
+    }
+
+  start = idx * ELEM_BITS + first_set (elem);
+  return start < end ? start : end;
+}
+
 /* Creation and destruction. */
 
 /* Creates and returns a pointer to a newly allocated bitmap with room for
@@ -217,14 +269,26 @@ bitmap_set_all (struct bitmap *b, bool value)
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  /* Set or clear whole elements at a time, with the same atomic
+     instructions that bitmap_mark() and bitmap_reset() use. */
+  while (cnt > 0)
+    {
+      size_t ofs = start % ELEM_BITS;
+      size_t chunk = ELEM_BITS - ofs < cnt ? ELEM_BITS - ofs : cnt;
+      elem_type mask = range_mask (ofs, chunk);
+      elem_type *elem = &b->bits[elem_idx (start)];
+
+      if (value)
+        asm ("orl %1, %0" : "=m" (*elem) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "=m" (*elem) : "r" (~mask) : "cc");
+      start += chunk;
+      cnt -= chunk;
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -232,16 +296,26 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value)
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i, value_cnt;
+  size_t value_cnt;
 
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
   value_cnt = 0;
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      value_cnt++;
+  while (cnt > 0)
+    {
+      size_t ofs = start % ELEM_BITS;
+      size_t chunk = ELEM_BITS - ofs < cnt ? ELEM_BITS - ofs : cnt;
+      elem_type elem = (elem_match (b, elem_idx (start), value)
+                        & range_mask (ofs, chunk));
+
+      /* Count set bits by clearing the lowest one at a time. */
+      for (; elem != 0; elem &= elem - 1)
+        value_cnt++;
+      start += chunk;
+      cnt -= chunk;
+    }
   return value_cnt;
 }
 
@@ -250,16 +324,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return next_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -298,13 +367,29 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
+  if (cnt == 0)
+    return start;
   if (cnt <= b->bit_cnt) 
     {
       size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t i = start;
+
+      /* Alternate between finding the next bit set to VALUE, which
+         may start a run, and the next bit set to !VALUE, which
+         ends it.  A run that is too short is skipped as a whole,
+         so each element is looked at about once. */
+      while (i <= last)
+        {
+          size_t end;
+
+          i = next_bit (b, i, last + 1, value);
+          if (i > last)
+            break;
+          end = next_bit (b, i, i + cnt, !value);
+          if (end == i + cnt)
+            return i;
+          i = end + 1;
+        }
     }
   return BITMAP_ERROR;
 }
@@ -39,7 +39,26 @@ enum
     SYS_MKDIR,                  /* Create a directory. */
     SYS_READDIR,                /* Reads a directory entry. */
     SYS_ISDIR,                  /* Tests if a fd represents a directory. */
-    SYS_INUMBER                 /* Returns the inode number for a fd. */
+    SYS_INUMBER,                /* Returns the inode number for a fd. */
+    SYS_READDIR_BATCH,          /* Reads many directory entries. */
+    SYS_STAT,                   /* Gets a file's attributes by name. */
+
+    /* Vectored and positional I/O. */
+    SYS_READV,                  /* Read into several buffers. */
+    SYS_WRITEV,                 /* Write from several buffers. */
+    SYS_PREAD,                  /* Read at a given file offset. */
+    SYS_PWRITE,                 /* Write at a given file offset. */
+    SYS_COPY_FILE_RANGE,        /* Copy between files in the kernel. */
+    SYS_FALLOCATE,              /* Allocate a file's sectors ahead. */
+
+    /* Durability. */
+    SYS_FSYNC,                  /* Write a file's data and inode to disk. */
+    SYS_FDATASYNC,              /* Write a file's data to disk. */
+
+    /* Statistics. */
+    SYS_PAGE_FAULT_COUNT,       /* Returns the number of page faults. */
+    SYS_SYSCALL_STAT,           /* Returns statistics for a syscall. */
+    SYS_CACHE_STAT              /* Returns buffer cache statistics. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -0,0 +1,58 @@
+#ifndef __LIB_SYSCALL_TYPES_H
+#define __LIB_SYSCALL_TYPES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Types exchanged between user programs and the kernel by system
+   calls. */
+
+/* Statistics for one system call, as returned by
+   get_syscall_stat(). */
+struct syscall_stat
+  {
+    uint64_t calls;             /* Number of invocations. */
+    uint64_t cycles;            /* Total time-stamp counter cycles. */
+  };
+
+/* Buffer cache statistics of a file or a process, as returned by
+   get_cache_stat().  Misses are reads less hits. */
+struct cache_stat
+  {
+    uint32_t reads;             /* Sector lookups. */
+    uint32_t hits;              /* Lookups found in the cache. */
+    uint32_t writes;            /* Sectors written into the cache. */
+    uint32_t evictions;         /* Sectors evicted. */
+    uint32_t write_backs;       /* Dirty sectors written to disk. */
+  };
+
+/* Passed to get_cache_stat() in place of a file descriptor to get
+   the calling process's statistics. */
+#define CACHE_STAT_SELF -1
+
+/* One buffer of a readv() or writev() vector. */
+struct iovec
+  {
+    void *iov_base;             /* Start of buffer. */
+    size_t iov_len;             /* Length of buffer in bytes. */
+  };
+
+/* One directory entry, as returned by readdir_batch(). */
+struct dirent
+  {
+    uint32_t inumber;           /* Inode number of the entry. */
+    uint8_t is_dir;             /* Nonzero if it is a directory. */
+    char name[14 + 1];          /* Null-terminated file name. */
+  };
+
+/* Attributes of a file or directory, as returned by stat(). */
+struct stat
+  {
+    uint32_t inumber;           /* Inode number. */
+    int32_t length;             /* Length in bytes. */
+    uint32_t blocks;            /* Data and indirect sectors in use,
+                                   0 if the data is in the inode. */
+    uint8_t is_dir;             /* Nonzero if it is a directory. */
+  };
+
+#endif /* lib/syscall-types.h */
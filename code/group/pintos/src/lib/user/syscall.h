@@ -3,6 +3,7 @@
 
 #include <stdbool.h>
 #include <debug.h>
+#include <syscall-types.h>
 #include "devices/block.h"
 
 /* Process identifier. */
@@ -49,6 +50,23 @@ int get_cache_hit_count (void);
 /* student testing-2 */
 void get_stats (void);
 
+/* Vectored and positional I/O. */
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int copy_file_range (int fd_in, int fd_out, unsigned length);
+int fallocate (int fd, unsigned length);
+
+/* Durability. */
+int fsync (int fd);
+int fdatasync (int fd);
+
+/* Statistics. */
+int get_page_fault_count (void);
+bool get_syscall_stat (int number, struct syscall_stat *);
+bool get_cache_stat (int fd, struct cache_stat *);
+
 
 /* Project 4 only. */
 bool chdir (const char *dir);
@@ -56,5 +74,7 @@ bool mkdir (const char *dir);
 bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
+int readdir_batch (int fd, struct dirent *, unsigned size);
+bool stat (const char *file, struct stat *);
 
 #endif /* lib/user/syscall.h */
\ No newline at end of file
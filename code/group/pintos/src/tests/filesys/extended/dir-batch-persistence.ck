@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+my ($tree) = {'d' => {'sub' => {}}};
+$tree->{'d'}{"f$_"} = [''] foreach 0...19;
+check_archive ($tree);
+pass;
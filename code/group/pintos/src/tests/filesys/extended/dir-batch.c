@@ -0,0 +1,70 @@
+/* Creates a directory holding a subdirectory and 20 files, then
+   lists it with readdir_batch() three entries at a time, checking
+   that every entry comes back exactly once with the right type
+   and inode number. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 20
+
+void
+test_main (void) 
+{
+  bool seen[FILE_CNT + 1];
+  struct dirent ents[3];
+  int total = 0;
+  int dir_fd, sub_fd, cnt, i;
+
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  CHECK (mkdir ("d/sub"), "mkdir \"d/sub\"");
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      char name[16];
+      snprintf (name, sizeof name, "d/f%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+  msg ("created %d files", FILE_CNT);
+
+  CHECK ((sub_fd = open ("d/sub")) > 1, "open \"d/sub\"");
+  CHECK ((dir_fd = open ("d")) > 1, "open \"d\"");
+  memset (seen, 0, sizeof seen);
+  while ((cnt = readdir_batch (dir_fd, ents, sizeof ents)) > 0)
+    for (i = 0; i < cnt; i++)
+      {
+        const struct dirent *e = &ents[i];
+        int idx;
+
+        if (!strcmp (e->name, "sub"))
+          {
+            idx = FILE_CNT;
+            if (!e->is_dir || (int) e->inumber != inumber (sub_fd))
+              fail ("wrong type or inumber for \"sub\"");
+          }
+        else if (e->name[0] == 'f' && e->name[1] != '\0')
+          {
+            idx = atoi (e->name + 1);
+            if (e->is_dir)
+              fail ("\"%s\" listed as a directory", e->name);
+          }
+        else
+          fail ("unexpected entry \"%s\"", e->name);
+        if (idx < 0 || idx > FILE_CNT || seen[idx])
+          fail ("entry \"%s\" unexpected or listed twice", e->name);
+        seen[idx] = true;
+        total++;
+      }
+  CHECK (cnt == 0, "readdir_batch reaches end");
+  CHECK (total == FILE_CNT + 1, "listed %d entries", FILE_CNT + 1);
+  CHECK (readdir_batch (dir_fd, ents, sizeof ents) == 0,
+         "readdir_batch stays at end");
+  msg ("close \"d\"");
+  close (dir_fd);
+  msg ("close \"d/sub\"");
+  close (sub_fd);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-batch) begin
+(dir-batch) mkdir "d"
+(dir-batch) mkdir "d/sub"
+(dir-batch) created 20 files
+(dir-batch) open "d/sub"
+(dir-batch) open "d"
+(dir-batch) readdir_batch reaches end
+(dir-batch) listed 21 entries
+(dir-batch) readdir_batch stays at end
+(dir-batch) close "d"
+(dir-batch) close "d/sub"
+(dir-batch) end
+EOF
+pass;
@@ -0,0 +1,8 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_archive ({'d' => {'small' => ['0123456789'],
+                        'big' => ['x' x 2000],
+                        'sparse' => ["\0" x 100000 . 'y']}});
+pass;
@@ -0,0 +1,67 @@
+/* Creates a directory holding an inline file, a file of a few
+   sectors, and a sparse file, then checks what stat() reports for
+   each of them, for the directory and the root, and that it fails
+   for names that do not exist. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[2000];
+
+/* Checks that stat() of FILE reports LENGTH bytes, IS_DIR, and
+   BLOCKS sectors in use. */
+static void
+check_stat (const char *file, int length, bool is_dir, unsigned blocks)
+{
+  struct stat st;
+
+  CHECK (stat (file, &st), "stat \"%s\"", file);
+  if (st.length != length)
+    fail ("\"%s\" has length %d, expected %d", file, (int) st.length, length);
+  if (!st.is_dir != !is_dir)
+    fail ("\"%s\" has wrong type", file);
+  if (st.blocks != blocks)
+    fail ("\"%s\" uses %u blocks, expected %u",
+          file, (unsigned) st.blocks, blocks);
+}
+
+void
+test_main (void) 
+{
+  struct stat st;
+  int fd;
+
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+
+  CHECK (create ("d/small", 0), "create \"d/small\"");
+  CHECK ((fd = open ("d/small")) > 1, "open \"d/small\"");
+  CHECK (write (fd, "0123456789", 10) == 10, "write \"d/small\"");
+  check_stat ("d/small", 10, false, 0);
+  CHECK (stat ("d/small", &st) && (int) st.inumber == inumber (fd),
+         "stat \"d/small\" matches inumber");
+  msg ("close \"d/small\"");
+  close (fd);
+
+  memset (buf, 'x', sizeof buf);
+  CHECK (create ("d/big", 0), "create \"d/big\"");
+  CHECK ((fd = open ("d/big")) > 1, "open \"d/big\"");
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"d/big\"");
+  msg ("close \"d/big\"");
+  close (fd);
+  check_stat ("d/big", sizeof buf, false, 4);
+
+  CHECK (create ("d/sparse", 0), "create \"d/sparse\"");
+  CHECK ((fd = open ("d/sparse")) > 1, "open \"d/sparse\"");
+  seek (fd, 100000);
+  CHECK (write (fd, "y", 1) == 1, "write \"d/sparse\" at 100000");
+  msg ("close \"d/sparse\"");
+  close (fd);
+  check_stat ("d/sparse", 100001, false, 2);
+
+  CHECK (stat ("d", &st) && st.is_dir, "stat \"d\"");
+  CHECK (stat ("/", &st) && st.is_dir, "stat \"/\"");
+  CHECK (!stat ("d/none", &st), "stat \"d/none\" (must fail)");
+  CHECK (!stat ("d/small/x", &st), "stat \"d/small/x\" (must fail)");
+}
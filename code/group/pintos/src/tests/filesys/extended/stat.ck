@@ -0,0 +1,30 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(stat) begin
+(stat) mkdir "d"
+(stat) create "d/small"
+(stat) open "d/small"
+(stat) write "d/small"
+(stat) stat "d/small"
+(stat) stat "d/small" matches inumber
+(stat) close "d/small"
+(stat) create "d/big"
+(stat) open "d/big"
+(stat) write "d/big"
+(stat) close "d/big"
+(stat) stat "d/big"
+(stat) create "d/sparse"
+(stat) open "d/sparse"
+(stat) write "d/sparse" at 100000
+(stat) close "d/sparse"
+(stat) stat "d/sparse"
+(stat) stat "d"
+(stat) stat "/"
+(stat) stat "d/none" (must fail)
+(stat) stat "d/small/x" (must fail)
+(stat) end
+EOF
+pass;
@@ -0,0 +1,119 @@
+/* Test program and micro-benchmark for bitmap scanning in
+   lib/kernel/bitmap.c.
+
+   Builds a free map the size of an 8 MB disk, fragments it the
+   way a long-lived file system would, and checks that
+   bitmap_scan() finds the same runs as a one-bit-at-a-time
+   reference scan while timing both.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include "threads/test.h"
+#include "threads/tsc.h"
+
+/* Sectors in an 8 MB disk. */
+#define BIT_CNT (8 * 1024 * 1024 / 512)
+
+/* Number of scans timed for each run length. */
+#define SCAN_CNT 64
+
+static size_t reference_scan (const struct bitmap *, size_t start,
+                              size_t cnt, bool value);
+static void fragment (struct bitmap *);
+
+/* Compare bitmap_scan() against the reference scan. */
+void
+test (void) 
+{
+  static const size_t run_lengths[] = {1, 8, 64, 512};
+  struct bitmap *b = bitmap_create (BIT_CNT);
+  size_t i;
+
+  ASSERT (b != NULL);
+  fragment (b);
+  printf ("bitmap: %zu of %zu sectors in use\n",
+          bitmap_count (b, 0, BIT_CNT, true), (size_t) BIT_CNT);
+
+  for (i = 0; i < sizeof run_lengths / sizeof *run_lengths; i++)
+    {
+      size_t cnt = run_lengths[i];
+      uint64_t ref_cycles = 0, scan_cycles = 0;
+      int j;
+
+      for (j = 0; j < SCAN_CNT; j++)
+        {
+          size_t start = random_ulong () % BIT_CNT;
+          size_t expected, actual;
+          uint64_t t0, t1, t2;
+
+          t0 = rdtsc ();
+          expected = reference_scan (b, start, cnt, false);
+          t1 = rdtsc ();
+          actual = bitmap_scan (b, start, cnt, false);
+          t2 = rdtsc ();
+
+          ASSERT (actual == expected);
+          ref_cycles += t1 - t0;
+          scan_cycles += t2 - t1;
+        }
+      printf ("bitmap: run of %4zu: %10"PRIu64" cycles per bit scan, "
+              "%8"PRIu64" per word scan\n",
+              cnt, ref_cycles / SCAN_CNT, scan_cycles / SCAN_CNT);
+    }
+
+  bitmap_destroy (b);
+  printf ("bitmap: PASS\n");
+}
+
+/* The scan bitmap_scan() used to do: tests CNT bits starting at
+   every position in turn. */
+static size_t
+reference_scan (const struct bitmap *b, size_t start, size_t cnt,
+                bool value) 
+{
+  size_t last, i, j;
+
+  if (cnt > bitmap_size (b))
+    return BITMAP_ERROR;
+  last = bitmap_size (b) - cnt;
+  for (i = start; i <= last; i++)
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j) != value)
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Marks most of B in use, leaving free holes of random length
+   that grow toward the end of the map and a free tail at the
+   end, so that short runs are found quickly and long ones only
+   after a long scan. */
+static void
+fragment (struct bitmap *b) 
+{
+  size_t i = 0;
+
+  bitmap_set_all (b, true);
+  while (i < BIT_CNT - BIT_CNT / 16)
+    {
+      size_t used = 1 + random_ulong () % 64;
+      size_t hole = 1 + random_ulong () % (1 + i * 64 / BIT_CNT);
+
+      i += used;
+      if (i + hole > BIT_CNT)
+        break;
+      bitmap_set_multiple (b, i, hole, false);
+      i += hole;
+    }
+}
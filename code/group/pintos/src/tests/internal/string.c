@@ -0,0 +1,164 @@
+/* Test program and micro-benchmark for the block operations in
+   lib/string.c.
+
+   Checks memcpy(), memset(), memcmp() and strlen() against
+   simple byte loops at every alignment, then times both on
+   sector-sized (512-byte) and page-sized (4 kB) blocks.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+#include "threads/tsc.h"
+
+/* Largest block tested, plus room for misalignment. */
+#define MAX_SIZE 4096
+#define BUF_SIZE (MAX_SIZE + 16)
+
+/* Number of times each block operation is timed. */
+#define REPEAT 256
+
+static uint8_t src[BUF_SIZE], dst[BUF_SIZE], ref[BUF_SIZE];
+
+static void check_alignments (void);
+static void benchmark (size_t size);
+static void byte_memcpy (void *, const void *, size_t);
+static void byte_memset (void *, int, size_t);
+static int byte_memcmp (const void *, const void *, size_t);
+
+/* Test and time the string block operations. */
+void
+test (void) 
+{
+  check_alignments ();
+  benchmark (512);
+  benchmark (4096);
+  printf ("string: PASS\n");
+}
+
+/* Compares each operation to its byte loop for all small sizes
+   and every combination of source and destination alignment. */
+static void
+check_alignments (void) 
+{
+  size_t size, s_ofs, d_ofs, i;
+
+  random_bytes (src, sizeof src);
+  for (size = 0; size <= 64; size++)
+    for (s_ofs = 0; s_ofs < 8; s_ofs++)
+      for (d_ofs = 0; d_ofs < 8; d_ofs++)
+        {
+          memset (dst, 0x5a, sizeof dst);
+          memset (ref, 0x5a, sizeof ref);
+          ASSERT (memcpy (dst + d_ofs, src + s_ofs, size) == dst + d_ofs);
+          byte_memcpy (ref + d_ofs, src + s_ofs, size);
+          ASSERT (byte_memcmp (dst, ref, sizeof dst) == 0);
+
+          ASSERT (memset (dst + d_ofs, s_ofs, size) == dst + d_ofs);
+          byte_memset (ref + d_ofs, s_ofs, size);
+          ASSERT (byte_memcmp (dst, ref, sizeof dst) == 0);
+
+          /* Flip one byte and check the comparison's sign. */
+          memcpy (dst + d_ofs, src + s_ofs, size);
+          if (size > 0)
+            dst[d_ofs + random_ulong () % size] ^= 1 << s_ofs;
+          ASSERT ((memcmp (src + s_ofs, dst + d_ofs, size) > 0)
+                  == (byte_memcmp (src + s_ofs, dst + d_ofs, size) > 0));
+          ASSERT ((memcmp (src + s_ofs, dst + d_ofs, size) < 0)
+                  == (byte_memcmp (src + s_ofs, dst + d_ofs, size) < 0));
+
+          /* A string of SIZE nonzero bytes. */
+          for (i = 0; i < size; i++)
+            dst[d_ofs + i] = src[s_ofs + i] | 1;
+          dst[d_ofs + size] = '\0';
+          ASSERT (strlen ((char *) dst + d_ofs) == size);
+        }
+}
+
+/* Times the string operations against their byte loops on
+   word-aligned blocks of SIZE bytes and prints the results. */
+static void
+benchmark (size_t size) 
+{
+  uint64_t start, fast, slow;
+  volatile int result;
+  int i;
+
+  ASSERT (size <= MAX_SIZE);
+
+  start = rdtsc ();
+  for (i = 0; i < REPEAT; i++)
+    memcpy (dst, src, size);
+  fast = rdtsc () - start;
+  start = rdtsc ();
+  for (i = 0; i < REPEAT; i++)
+    byte_memcpy (ref, src, size);
+  slow = rdtsc () - start;
+  printf ("string: memcpy %4zu bytes: %6"PRIu64" cycles, "
+          "byte loop %6"PRIu64"\n", size, fast / REPEAT, slow / REPEAT);
+
+  start = rdtsc ();
+  for (i = 0; i < REPEAT; i++)
+    memset (dst, i, size);
+  fast = rdtsc () - start;
+  start = rdtsc ();
+  for (i = 0; i < REPEAT; i++)
+    byte_memset (ref, i, size);
+  slow = rdtsc () - start;
+  printf ("string: memset %4zu bytes: %6"PRIu64" cycles, "
+          "byte loop %6"PRIu64"\n", size, fast / REPEAT, slow / REPEAT);
+
+  ASSERT (memcmp (dst, ref, size) == 0);
+  start = rdtsc ();
+  for (i = 0; i < REPEAT; i++)
+    result = memcmp (dst, ref, size);
+  fast = rdtsc () - start;
+  start = rdtsc ();
+  for (i = 0; i < REPEAT; i++)
+    result = byte_memcmp (dst, ref, size);
+  slow = rdtsc () - start;
+  ASSERT (result == 0);
+  printf ("string: memcmp %4zu bytes: %6"PRIu64" cycles, "
+          "byte loop %6"PRIu64"\n", size, fast / REPEAT, slow / REPEAT);
+}
+
+/* The byte loops lib/string.c used before, kept out of line so
+   the compiler does not replace them with the library calls. */
+
+static void __attribute__ ((noinline))
+byte_memcpy (void *dst_, const void *src_, size_t size) 
+{
+  volatile uint8_t *dst = dst_;
+  const uint8_t *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+}
+
+static void __attribute__ ((noinline))
+byte_memset (void *dst_, int value, size_t size) 
+{
+  volatile uint8_t *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+}
+
+static int __attribute__ ((noinline))
+byte_memcmp (const void *a_, const void *b_, size_t size) 
+{
+  const uint8_t *a = a_;
+  const uint8_t *b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
@@ -0,0 +1,12 @@
+/* Runs rwlock_self_test(), which checks that readers share a
+   readers-writer lock and that a writer waits for the last
+   reader to leave. */
+
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+
+void
+test_rwlock (void) 
+{
+  rwlock_self_test ();
+}
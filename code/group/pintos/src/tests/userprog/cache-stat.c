@@ -0,0 +1,38 @@
+/* Writes a two-sector file, reads it back twice, and checks the
+   file's and the process's buffer cache statistics from
+   get_cache_stat(), and that a bad descriptor fails. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[1024];
+
+void
+test_main (void) 
+{
+  struct cache_stat before, after, self;
+  int fd;
+
+  memset (buf, 'a', sizeof buf);
+  CHECK (create ("stats", 0), "create \"stats\"");
+  CHECK ((fd = open ("stats")) > 1, "open \"stats\"");
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"stats\"");
+  CHECK (get_cache_stat (fd, &before), "get_cache_stat \"stats\"");
+  CHECK (before.writes >= 2, "writes counted");
+
+  seek (fd, 0);
+  CHECK (read (fd, buf, sizeof buf) == sizeof buf, "read \"stats\"");
+  CHECK (get_cache_stat (fd, &after), "get_cache_stat \"stats\"");
+  CHECK (after.reads - before.reads == 2, "2 sector reads counted");
+  CHECK (after.hits - before.hits == 2, "2 hits counted");
+
+  CHECK (get_cache_stat (CACHE_STAT_SELF, &self), "get_cache_stat self");
+  CHECK (self.reads >= after.reads && self.writes >= after.writes,
+         "process counts include the file's");
+
+  CHECK (!get_cache_stat (fd + 100, &after), "get_cache_stat bad fd");
+  msg ("close \"stats\"");
+  close (fd);
+}
@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(cache-stat) begin
+(cache-stat) create "stats"
+(cache-stat) open "stats"
+(cache-stat) write "stats"
+(cache-stat) get_cache_stat "stats"
+(cache-stat) writes counted
+(cache-stat) read "stats"
+(cache-stat) get_cache_stat "stats"
+(cache-stat) 2 sector reads counted
+(cache-stat) 2 hits counted
+(cache-stat) get_cache_stat self
+(cache-stat) process counts include the file's
+(cache-stat) get_cache_stat bad fd
+(cache-stat) close "stats"
+(cache-stat) end
+cache-stat: exit(0)
+EOF
+pass;
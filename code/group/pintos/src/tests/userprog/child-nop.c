@@ -0,0 +1,12 @@
+/* Child process run by exec-bench.  Does no work and prints
+   nothing, so that its parent times only process creation and
+   teardown.  Returns its argument count, not counting the
+   program name. */
+
+#include <debug.h>
+
+int
+main (int argc, char *argv[] UNUSED) 
+{
+  return argc - 1;
+}
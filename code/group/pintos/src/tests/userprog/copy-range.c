@@ -0,0 +1,89 @@
+/* Copies a file that has a hole in the middle with
+   copy_file_range(), once with both positions sector-aligned and
+   once with both unaligned, and checks the copied bytes, that
+   the hole stays a hole, and that overlapping ranges in one file
+   are rejected. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LENGTH 4000             /* Length of "src". */
+#define HOLE_START 1536         /* Sectors 3 to 5 are a hole. */
+#define HOLE_END 3072
+
+static char expect[LENGTH];
+static char buf[LENGTH];
+
+/* Checks that the SIZE bytes of FILE at OFFSET equal EXPECTED. */
+static void
+check_bytes (const char *file, int fd, unsigned offset, const char *expected,
+             size_t size)
+{
+  size_t i;
+
+  seek (fd, offset);
+  if (read (fd, buf, size) != (int) size)
+    fail ("short read of \"%s\"", file);
+  for (i = 0; i < size; i++)
+    if (buf[i] != expected[i])
+      fail ("byte %zu of \"%s\" is %d, expected %d",
+            i + offset, file, buf[i], expected[i]);
+}
+
+void
+test_main (void) 
+{
+  static const char zeros[512];
+  struct stat src_st, dst_st;
+  int src, dst, src2;
+  size_t i;
+
+  for (i = 0; i < LENGTH; i++)
+    expect[i] = i < HOLE_START || i >= HOLE_END ? i % 251 + 1 : 0;
+  memset (expect + 1500, 0, HOLE_START - 1500);
+
+  CHECK (create ("src", 0), "create \"src\"");
+  CHECK ((src = open ("src")) > 1, "open \"src\"");
+  CHECK (write (src, expect, 1500) == 1500, "write \"src\" before hole");
+  seek (src, HOLE_END);
+  CHECK (write (src, expect + HOLE_END, LENGTH - HOLE_END)
+         == LENGTH - HOLE_END, "write \"src\" after hole");
+
+  /* Aligned: whole sectors go cache entry to cache entry. */
+  CHECK (create ("aligned", 0), "create \"aligned\"");
+  CHECK ((dst = open ("aligned")) > 1, "open \"aligned\"");
+  seek (src, 0);
+  CHECK (copy_file_range (src, dst, LENGTH) == LENGTH,
+         "copy %d bytes aligned", LENGTH);
+  CHECK (filesize (dst) == LENGTH, "filesize is %d", LENGTH);
+  check_bytes ("aligned", dst, 0, expect, LENGTH);
+  CHECK (stat ("src", &src_st) && stat ("aligned", &dst_st)
+         && src_st.blocks == dst_st.blocks, "hole copied as a hole");
+  close (dst);
+
+  /* Unaligned: every chunk straddles a sector boundary. */
+  CHECK (create ("unaligned", 0), "create \"unaligned\"");
+  CHECK ((dst = open ("unaligned")) > 1, "open \"unaligned\"");
+  seek (src, 100);
+  seek (dst, 300);
+  CHECK (copy_file_range (src, dst, LENGTH) == LENGTH - 100,
+         "copy %d bytes unaligned", LENGTH - 100);
+  CHECK (filesize (dst) == LENGTH + 200, "filesize is %d", LENGTH + 200);
+  check_bytes ("unaligned", dst, 0, zeros, 300);
+  check_bytes ("unaligned", dst, 300, expect + 100, LENGTH - 100);
+  close (dst);
+
+  /* Overlap within one file must fail and change nothing. */
+  CHECK ((src2 = open ("src")) > 1, "open \"src\" again");
+  seek (src, 0);
+  seek (src2, 100);
+  CHECK (copy_file_range (src, src2, 500) == -1,
+         "copy overlapping range (must fail)");
+  CHECK (tell (src) == 0 && tell (src2) == 100, "positions unchanged");
+  check_bytes ("src", src, 0, expect, LENGTH);
+  msg ("close \"src\"");
+  close (src2);
+  close (src);
+}
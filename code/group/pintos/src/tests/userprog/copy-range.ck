@@ -0,0 +1,27 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(copy-range) begin
+(copy-range) create "src"
+(copy-range) open "src"
+(copy-range) write "src" before hole
+(copy-range) write "src" after hole
+(copy-range) create "aligned"
+(copy-range) open "aligned"
+(copy-range) copy 4000 bytes aligned
+(copy-range) filesize is 4000
+(copy-range) hole copied as a hole
+(copy-range) create "unaligned"
+(copy-range) open "unaligned"
+(copy-range) copy 3900 bytes unaligned
+(copy-range) filesize is 4200
+(copy-range) open "src" again
+(copy-range) copy overlapping range (must fail)
+(copy-range) positions unchanged
+(copy-range) close "src"
+(copy-range) end
+copy-range: exit(0)
+EOF
+pass;
@@ -0,0 +1,38 @@
+/* Measures process spawn latency: execs CHILD_CNT copies of
+   child-nop, each with a few arguments so that argument passing
+   is exercised, and waits for each in turn.  Reports the average
+   cycles spent in the exec and wait system calls, as counted by
+   the kernel. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CHILD_CNT 20
+
+void
+test_main (void) 
+{
+  struct syscall_stat exec_before, exec_after, wait_before, wait_after;
+  int i;
+
+  get_syscall_stat (SYS_EXEC, &exec_before);
+  get_syscall_stat (SYS_WAIT, &wait_before);
+  for (i = 0; i < CHILD_CNT; i++)
+    {
+      pid_t child = exec ("child-nop one two three four");
+      if (child == -1)
+        fail ("exec \"child-nop\" #%d failed", i);
+      if (wait (child) != 4)
+        fail ("child-nop #%d got wrong arguments", i);
+    }
+  get_syscall_stat (SYS_EXEC, &exec_after);
+  get_syscall_stat (SYS_WAIT, &wait_after);
+
+  msg ("spawned and waited for %d children", CHILD_CNT);
+  msg ("exec: %d cycles per call",
+       (int) ((exec_after.cycles - exec_before.cycles) / CHILD_CNT));
+  msg ("wait: %d cycles per call",
+       (int) ((wait_after.cycles - wait_before.cycles) / CHILD_CNT));
+}
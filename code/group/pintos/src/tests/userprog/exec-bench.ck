@@ -0,0 +1,24 @@
+# -*- perl -*-
+
+# The cycle counts vary from run to run, so those lines are
+# dropped, along with the children's exit messages, before the
+# output is compared.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+@output = grep (!/^\(exec-bench\) (exec|wait): \d+ cycles per call$/
+		&& !/^child-nop: exit\(4\)$/, @output);
+
+compare_output ("run", IGNORE_USER_FAULTS => 1, \@output, [<<'EOF']);
+(exec-bench) begin
+(exec-bench) spawned and waited for 20 children
+(exec-bench) end
+exec-bench: exit(0)
+EOF
+pass;
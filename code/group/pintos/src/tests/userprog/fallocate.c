@@ -0,0 +1,42 @@
+/* Preallocates a file with fallocate(), checks that it grows and
+   reads back as zeros, writes into the preallocated range, and
+   checks that a shorter fallocate() leaves its length alone and
+   that a bad descriptor fails. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LENGTH 5000
+
+static char buf[LENGTH];
+
+void
+test_main (void) 
+{
+  static const char text[] = "preallocated";
+  size_t i;
+  int fd;
+
+  CHECK (create ("prealloc", 0), "create \"prealloc\"");
+  CHECK ((fd = open ("prealloc")) > 1, "open \"prealloc\"");
+  CHECK (fallocate (fd, LENGTH) == 0, "fallocate %d bytes", LENGTH);
+  CHECK (filesize (fd) == LENGTH, "filesize is %d", LENGTH);
+
+  CHECK (read (fd, buf, LENGTH) == LENGTH, "read \"prealloc\"");
+  for (i = 0; i < LENGTH; i++)
+    if (buf[i] != 0)
+      fail ("byte %zu is %d, not 0", i, buf[i]);
+
+  CHECK (pwrite (fd, text, sizeof text, 1000) == sizeof text,
+         "write inside preallocated range");
+  CHECK (fallocate (fd, 10) == 0, "fallocate 10 bytes");
+  CHECK (filesize (fd) == LENGTH, "filesize is still %d", LENGTH);
+  CHECK (pread (fd, buf, sizeof text, 1000) == sizeof text,
+         "read back write");
+  if (memcmp (buf, text, sizeof text))
+    fail ("data written into preallocated range changed");
+
+  CHECK (fallocate (fd + 100, LENGTH) == -1, "fallocate bad fd");
+}
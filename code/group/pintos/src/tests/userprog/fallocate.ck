@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(fallocate) begin
+(fallocate) create "prealloc"
+(fallocate) open "prealloc"
+(fallocate) fallocate 5000 bytes
+(fallocate) filesize is 5000
+(fallocate) read "prealloc"
+(fallocate) write inside preallocated range
+(fallocate) fallocate 10 bytes
+(fallocate) filesize is still 5000
+(fallocate) read back write
+(fallocate) fallocate bad fd
+(fallocate) end
+fallocate: exit(0)
+EOF
+pass;
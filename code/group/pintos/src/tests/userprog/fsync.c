@@ -0,0 +1,28 @@
+/* Writes sample.txt's contents to a new file, syncs it with
+   fsync() and fdatasync(), and reads it back.  Also checks that
+   syncing a descriptor that is not open fails. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  size_t len = sizeof sample - 1;
+  char buf[sizeof sample];
+  int fd;
+
+  CHECK (create ("synced", 0), "create \"synced\"");
+  CHECK ((fd = open ("synced")) > 1, "open \"synced\"");
+  CHECK (write (fd, sample, len) == (int) len, "write \"synced\"");
+  CHECK (fsync (fd) == 0, "fsync \"synced\"");
+  CHECK (pwrite (fd, sample, len / 2, 0) == (int) (len / 2),
+         "overwrite \"synced\"");
+  CHECK (fdatasync (fd) == 0, "fdatasync \"synced\"");
+  CHECK (pread (fd, buf, len, 0) == (int) len, "read \"synced\"");
+  compare_bytes (buf, sample, len, 0, "synced");
+  CHECK (fsync (fd + 100) == -1, "fsync bad fd");
+  CHECK (fdatasync (fd + 100) == -1, "fdatasync bad fd");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(fsync) begin
+(fsync) create "synced"
+(fsync) open "synced"
+(fsync) write "synced"
+(fsync) fsync "synced"
+(fsync) overwrite "synced"
+(fsync) fdatasync "synced"
+(fsync) read "synced"
+(fsync) fsync bad fd
+(fsync) fdatasync bad fd
+(fsync) end
+fsync: exit(0)
+EOF
+pass;
@@ -0,0 +1,48 @@
+/* Writes sample.txt's contents to a new file as three records
+   with one writev(), reads them back out of order with pread(),
+   and then with one readv(), checking the file position each
+   positional call leaves alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define REC_CNT 3
+
+void
+test_main (void) 
+{
+  size_t len = sizeof sample - 1;
+  size_t ofs[REC_CNT + 1] = {0, len / 3, len / 2, len};
+  struct iovec iov[REC_CNT];
+  char buf[sizeof sample];
+  int fd, i;
+
+  CHECK (create ("records", 0), "create \"records\"");
+  CHECK ((fd = open ("records")) > 1, "open \"records\"");
+
+  for (i = 0; i < REC_CNT; i++)
+    {
+      iov[i].iov_base = sample + ofs[i];
+      iov[i].iov_len = ofs[i + 1] - ofs[i];
+    }
+  CHECK (writev (fd, iov, REC_CNT) == (int) len, "writev %d records", REC_CNT);
+  CHECK (tell (fd) == len, "tell after writev");
+
+  memset (buf, 0, sizeof buf);
+  for (i = REC_CNT - 1; i >= 0; i--)
+    if (pread (fd, buf + ofs[i], ofs[i + 1] - ofs[i], ofs[i])
+        != (int) (ofs[i + 1] - ofs[i]))
+      fail ("pread of record %d failed", i);
+  CHECK (tell (fd) == len, "tell after pread");
+  compare_bytes (buf, sample, len, 0, "records");
+
+  memset (buf, 0, sizeof buf);
+  for (i = 0; i < REC_CNT; i++)
+    iov[i].iov_base = buf + ofs[i];
+  seek (fd, 0);
+  CHECK (readv (fd, iov, REC_CNT) == (int) len, "readv %d records", REC_CNT);
+  compare_bytes (buf, sample, len, 0, "records");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(iov-pio) begin
+(iov-pio) create "records"
+(iov-pio) open "records"
+(iov-pio) writev 3 records
+(iov-pio) tell after writev
+(iov-pio) tell after pread
+(iov-pio) readv 3 records
+(iov-pio) end
+iov-pio: exit(0)
+EOF
+pass;
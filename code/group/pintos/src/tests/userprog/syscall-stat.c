@@ -0,0 +1,29 @@
+/* Checks that the kernel counts system call invocations: makes a
+   known number of practice calls and verifies that the practice
+   count grew by exactly that much. */
+
+#include <syscall.h>
+#include <syscall-nr.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CALL_CNT 100
+
+void
+test_main (void)
+{
+  struct syscall_stat before, after;
+  int i;
+
+  CHECK (get_syscall_stat (SYS_PRACTICE, &before), "get practice stats");
+  for (i = 0; i < CALL_CNT; i++)
+    practice (i);
+  CHECK (get_syscall_stat (SYS_PRACTICE, &after), "get practice stats");
+
+  if (after.calls - before.calls != CALL_CNT)
+    fail ("expected %d calls, got %d", CALL_CNT,
+          (int) (after.calls - before.calls));
+  if (after.cycles <= before.cycles)
+    fail ("cycle total did not grow");
+  CHECK (!get_syscall_stat (-1, &after), "stats for bad syscall number");
+}
@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_USER_FAULTS => 1, [<<'EOF']);
+(syscall-stat) begin
+(syscall-stat) get practice stats
+(syscall-stat) get practice stats
+(syscall-stat) stats for bad syscall number
+(syscall-stat) end
+syscall-stat: exit(0)
+EOF
+pass;
@@ -0,0 +1,24 @@
+/* Child process of page-fault-around.
+   Reads through several pages of initialized data, which are
+   loaded from the executable on demand. */
+
+#include "tests/lib.h"
+
+const char *test_name = "child-fault-around";
+
+#define SIZE (6 * 4096)
+static char buf[SIZE] = { 1 };
+
+int
+main (void)
+{
+  size_t i;
+  int sum = 0;
+
+  for (i = 0; i < SIZE; i += 512)
+    sum += buf[i];
+
+  if (sum != 1)
+    fail ("sum is %d, not 1", sum);
+  return 0x42;
+}
@@ -0,0 +1,59 @@
+/* Runs child-fault-around twice and reports how many page faults
+   each run took.  The first run starts with a cold buffer cache,
+   so every page of the child's data is faulted in on its own; in
+   the second run the data is cached and fault-around maps most
+   of it without further faults.
+
+   Extracting the child and loading this process go through the
+   cache too, so the cache is first made cold by writing and
+   reading back a scratch file four times the size of the default
+   64-sector cache. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define RUN_CNT 2
+
+/* Size of the scratch file, in bytes. */
+#define EVICT_SIZE (256 * 512)
+
+static char buf[4096];
+
+/* Fills the buffer cache with sectors of a scratch file. */
+static void
+evict_cache (void)
+{
+  int fd, i;
+
+  CHECK (create ("evict", 0), "create \"evict\"");
+  CHECK ((fd = open ("evict")) > 1, "open \"evict\"");
+  for (i = 0; i < EVICT_SIZE / (int) sizeof buf; i++)
+    if (write (fd, buf, sizeof buf) != (int) sizeof buf)
+      fail ("write \"evict\" failed");
+  seek (fd, 0);
+  for (i = 0; i < EVICT_SIZE / (int) sizeof buf; i++)
+    if (read (fd, buf, sizeof buf) != (int) sizeof buf)
+      fail ("read \"evict\" failed");
+  msg ("evicted the cache");
+  close (fd);
+}
+
+void
+test_main (void)
+{
+  int i;
+
+  evict_cache ();
+  for (i = 0; i < RUN_CNT; i++)
+    {
+      int faults = get_page_fault_count ();
+      pid_t child;
+
+      CHECK ((child = exec ("child-fault-around")) != -1,
+             "exec \"child-fault-around\"");
+      CHECK (wait (child) == 0x42, "wait for child");
+      msg ("run %d: %d page faults", i,
+           get_page_fault_count () - faults);
+    }
+}
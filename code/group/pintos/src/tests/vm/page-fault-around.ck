@@ -0,0 +1,42 @@
+# -*- perl -*-
+
+# The fault counts vary with the executable's layout, so they are
+# replaced by "#" before the output is compared; the second run,
+# with the child's data already cached, must then take fewer
+# faults than the first.
+
+use strict;
+use warnings;
+use tests::tests;
+
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+my (@faults);
+for (@output) {
+    if (my ($prefix, $count) = /^(\(page-fault-around\) run \d+:) (\d+) /) {
+        push (@faults, $count);
+        $_ = "$prefix # page faults";
+    }
+}
+fail "expected 2 fault counts but found " . scalar (@faults) . "\n"
+  if @faults != 2;
+
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(page-fault-around) begin
+(page-fault-around) create "evict"
+(page-fault-around) open "evict"
+(page-fault-around) evicted the cache
+(page-fault-around) exec "child-fault-around"
+(page-fault-around) wait for child
+(page-fault-around) run 0: # page faults
+(page-fault-around) exec "child-fault-around"
+(page-fault-around) wait for child
+(page-fault-around) run 1: # page faults
+(page-fault-around) end
+EOF
+
+fail "run 1 took $faults[1] page faults, not fewer than run 0's $faults[0]\n"
+  if $faults[1] >= $faults[0];
+pass;
@@ -2,13 +2,15 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/tsc.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -23,14 +25,50 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Each pool is managed as a buddy system.  Free memory is kept
+   as blocks of 2**ORDER pages, aligned to their size relative
+   to the pool base, on one free list per order.  An allocation
+   of N pages takes the smallest free block of at least N pages,
+   splitting larger blocks in half as needed, and gives back the
+   unused tail of the block at once, so no pages are wasted.
+   Freeing a block merges it with its "buddy", the other half of
+   the block it was split from, for as long as the buddy is free
+   too.  Both take time proportional to the number of orders,
+   instead of a scan over the whole pool.
+
+   The free list elements live in the free pages themselves.
+   ORDER_MAP records, for the first page of each free block, the
+   block's order, so that a buddy can be checked in O(1).
+
+   A pool is protected by turning interrupts off, not by a lock,
+   because thread_schedule_tail() frees a dying thread's page in
+   the middle of a context switch, where it must not sleep.  Each
+   allocation or free keeps them off for O(MAX_ORDER) steps. */
+
+/* Largest block order: 2**20 pages is 4 GB. */
+#define MAX_ORDER 20
+
+/* ORDER_MAP value for a page that does not start a free block. */
+#define NOT_FREE 0xff
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    uint8_t *order_map;                 /* Order of each free block. */
+    struct list free_lists[MAX_ORDER + 1];  /* Free blocks by order. */
     uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Number of pages in pool. */
+
+    /* Statistics. */
+    size_t free_cnt;                    /* Free pages. */
+    unsigned long long alloc_cnt;       /* Successful allocations. */
+    unsigned long long fail_cnt;        /* Failed allocations. */
+    unsigned long long split_cnt;       /* Blocks split in two. */
+    unsigned long long merge_cnt;       /* Buddies merged. */
+    uint64_t alloc_cycles;              /* Cycles spent allocating. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -39,6 +77,9 @@ static struct pool kernel_pool, user_pool;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static void print_pool_stats (struct pool *, const char *name);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -73,13 +114,25 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
   void *pages;
   size_t page_idx;
+  uint64_t start;
+  enum intr_level old_level;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  old_level = intr_disable ();
+  start = rdtsc ();
+  page_idx = buddy_alloc (pool, page_cnt);
+  pool->alloc_cycles += rdtsc () - start;
+  if (page_idx != BITMAP_ERROR)
+    {
+      ASSERT (bitmap_none (pool->used_map, page_idx, page_cnt));
+      bitmap_set_multiple (pool->used_map, page_idx, page_cnt, true);
+      pool->alloc_cnt++;
+    }
+  else
+    pool->fail_cnt++;
+  intr_set_level (old_level);
 
   if (page_idx != BITMAP_ERROR)
     pages = pool->base + PGSIZE * page_idx;
@@ -119,6 +172,7 @@ palloc_free_multiple (void *pages, size_t page_cnt)
 {
   struct pool *pool;
   size_t page_idx;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
@@ -137,8 +191,11 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  buddy_free (pool, page_idx, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +205,192 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
+/* Prints fragmentation and allocation latency statistics for
+   both pools. */
+void
+palloc_print_stats (void)
+{
+  print_pool_stats (&kernel_pool, "kernel");
+  print_pool_stats (&user_pool, "user");
+}
+
 /* Initializes pool P as starting at START and ending at END,
    naming it NAME for debugging purposes. */
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
+  /* We'll put the pool's used_map and order_map at its base.
+     Calculate the space needed for them and subtract it from the
+     pool's size.  The maps are sized for the whole pool, which
+     slightly overestimates what is left. */
+  size_t bm_size = ROUND_UP (bitmap_buf_size (page_cnt), sizeof (long));
+  size_t meta_pages = DIV_ROUND_UP (bm_size + page_cnt, PGSIZE);
+  int order;
+
+  if (meta_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  page_cnt -= meta_pages;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->order_map = (uint8_t *) base + bm_size;
+  memset (p->order_map, NOT_FREE, page_cnt);
+  for (order = 0; order <= MAX_ORDER; order++)
+    list_init (&p->free_lists[order]);
+  p->base = base + meta_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  p->free_cnt = 0;
+  p->alloc_cnt = p->fail_cnt = p->split_cnt = p->merge_cnt = 0;
+  p->alloc_cycles = 0;
+
+  /* Every page starts out free. */
+  buddy_free (p, 0, page_cnt);
+  p->merge_cnt = 0;
+}
+
+/* Returns the free list element in page PAGE_IDX of POOL. */
+static inline struct list_elem *
+page_elem (struct pool *pool, size_t page_idx)
+{
+  return (struct list_elem *) (pool->base + page_idx * PGSIZE);
+}
+
+/* Returns the index of the page that holds ELEM in POOL. */
+static inline size_t
+elem_page (struct pool *pool, struct list_elem *elem)
+{
+  return ((uint8_t *) elem - pool->base) / PGSIZE;
+}
+
+/* Adds the free block of 2**ORDER pages at PAGE_IDX to POOL's
+   free lists. */
+static void
+push_block (struct pool *pool, size_t page_idx, int order)
+{
+  pool->order_map[page_idx] = order;
+  list_push_front (&pool->free_lists[order], page_elem (pool, page_idx));
+}
+
+/* Removes the free block at PAGE_IDX from POOL's free lists. */
+static void
+remove_block (struct pool *pool, size_t page_idx)
+{
+  pool->order_map[page_idx] = NOT_FREE;
+  list_remove (page_elem (pool, page_idx));
+}
+
+/* Returns the smallest order whose blocks hold PAGE_CNT pages. */
+static int
+order_for (size_t page_cnt)
+{
+  int order = 0;
+  while (((size_t) 1 << order) < page_cnt)
+    order++;
+  return order;
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no free block is large
+   enough.  Interrupts must be off. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt)
+{
+  int want = order_for (page_cnt);
+  int order;
+  size_t page_idx;
+
+  /* Find the smallest nonempty free list that will do. */
+  for (order = want; order <= MAX_ORDER; order++)
+    if (!list_empty (&pool->free_lists[order]))
+      break;
+  if (order > MAX_ORDER)
+    return BITMAP_ERROR;
+
+  page_idx = elem_page (pool, list_front (&pool->free_lists[order]));
+  remove_block (pool, page_idx);
+
+  /* Split it down to the wanted order, freeing upper halves. */
+  while (order > want)
+    {
+      order--;
+      push_block (pool, page_idx + ((size_t) 1 << order), order);
+      pool->split_cnt++;
+    }
+  pool->free_cnt -= (size_t) 1 << want;
+
+  /* Give back the pages past PAGE_CNT. */
+  if (page_cnt < (size_t) 1 << want)
+    buddy_free (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+
+  return page_idx;
+}
+
+/* Returns the PAGE_CNT pages starting at PAGE_IDX to POOL,
+   merging each aligned power-of-2 piece with its free buddies.
+   Interrupts must be off, unless POOL is being initialized. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  pool->free_cnt += page_cnt;
+  while (page_cnt > 0)
+    {
+      size_t idx = page_idx;
+      int order = 0;
+
+      /* Largest aligned block that starts at PAGE_IDX and fits. */
+      while (order < MAX_ORDER
+             && (page_idx & ((size_t) 1 << order)) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+
+      /* Merge with the buddy for as long as it is free. */
+      while (order < MAX_ORDER)
+        {
+          size_t buddy = idx ^ ((size_t) 1 << order);
+          if (buddy + ((size_t) 1 << order) > pool->page_cnt
+              || pool->order_map[buddy] != order)
+            break;
+          remove_block (pool, buddy);
+          pool->merge_cnt++;
+          idx &= ~((size_t) 1 << order);
+          order++;
+        }
+      push_block (pool, idx, order);
+    }
+}
+
+/* Prints statistics for POOL, called NAME. */
+static void
+print_pool_stats (struct pool *pool, const char *name)
+{
+  size_t largest = 0;
+  int order;
+
+  printf ("Palloc %s:", name);
+  for (order = 0; order <= MAX_ORDER; order++)
+    if (!list_empty (&pool->free_lists[order]))
+      {
+        printf (" %zu@%d", list_size (&pool->free_lists[order]), order);
+        largest = (size_t) 1 << order;
+      }
+  printf ("\n");
+
+  /* External fragmentation: the share of free memory that is
+     not in the largest free block. */
+  printf ("Palloc %s: %zu of %zu pages free, largest block %zu, "
+          "fragmentation %zu%%\n", name, pool->free_cnt, pool->page_cnt,
+          largest,
+          pool->free_cnt > 0
+          ? (pool->free_cnt - largest) * 100 / pool->free_cnt : 0);
+  printf ("Palloc %s: %llu allocs, %llu failed, %llu splits, %llu merges, "
+          "%llu cycles per alloc\n", name, pool->alloc_cnt, pool->fail_cnt,
+          pool->split_cnt, pool->merge_cnt,
+          pool->alloc_cnt + pool->fail_cnt > 0
+          ? pool->alloc_cycles / (pool->alloc_cnt + pool->fail_cnt) : 0);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -0,0 +1,292 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator for fixed-size kernel objects.
+
+   Each kind of object gets its own cache, created with
+   kmem_cache_create().  A cache carves pages obtained from the
+   page allocator, called "slabs", into as many objects of
+   exactly its object size as fit after a small slab header, so
+   that an object wastes only its alignment padding rather than
+   the rest of a power-of-2 malloc() block.  Each cache has its
+   own lock, so allocations of different kinds of objects never
+   contend.
+
+   Slabs are kept on three lists: full slabs, partially used
+   slabs, and completely free slabs.  Allocations come from
+   partially used slabs first, so that free slabs stay free and
+   can be returned to the page allocator.  One free slab is kept
+   around to avoid thrashing when a single object is allocated
+   and freed repeatedly at a slab boundary.
+
+   If a cache has a constructor, it is run on every object when
+   its slab is created, not on every allocation, and freed
+   objects keep their constructed state.  Such objects keep
+   their free list link after the object instead of inside it. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Object cache. */
+struct kmem_cache
+  {
+    struct list_elem elem;      /* Element in all_caches. */
+    const char *name;           /* Name, for statistics. */
+    size_t obj_size;            /* Object size requested. */
+    size_t stride;              /* Bytes between objects in a slab. */
+    size_t link_ofs;            /* Offset of free link in a free object. */
+    size_t objs_per_slab;       /* Objects in each slab. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+    struct lock lock;           /* Protects the following members. */
+    struct list full;           /* Slabs with no free objects. */
+    struct list partial;        /* Slabs with some free objects. */
+    struct list empty;          /* Slabs with only free objects. */
+
+    /* Statistics. */
+    size_t slab_cnt;            /* Slabs currently allocated. */
+    size_t in_use;              /* Objects currently allocated. */
+    size_t peak_in_use;         /* Maximum value of IN_USE. */
+    unsigned long long alloc_cnt;       /* Calls to kmem_cache_alloc(). */
+    unsigned long long ctor_cnt;        /* Constructor calls. */
+  };
+
+/* Slab header, at the start of each slab's page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in one of CACHE's lists. */
+    size_t in_use;              /* Number of allocated objects. */
+    void *free;                 /* First free object. */
+  };
+
+/* All caches, for kmem_print_stats(). */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+static struct lock all_caches_lock;
+
+/* Address of the free list link of free object OBJ in C. */
+static inline void **
+free_link (const struct kmem_cache *c, void *obj)
+{
+  return (void **) ((uint8_t *) obj + c->link_ofs);
+}
+
+/* Creates and returns a cache of SIZE-byte objects named NAME.
+   If CTOR is nonnull, it constructs each new object.  Objects
+   must be smaller than about half a page.  Must be called after
+   malloc_init().  Returns a null pointer if memory is not
+   available. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor_func *ctor)
+{
+  struct kmem_cache *c;
+  static bool inited;
+
+  ASSERT (size > 0);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    return NULL;
+
+  c->name = name;
+  c->obj_size = size;
+  c->ctor = ctor;
+  if (ctor == NULL)
+    {
+      c->stride = ROUND_UP (size < sizeof (void *) ? sizeof (void *) : size,
+                            sizeof (void *));
+      c->link_ofs = 0;
+    }
+  else
+    {
+      c->link_ofs = ROUND_UP (size, sizeof (void *));
+      c->stride = c->link_ofs + sizeof (void *);
+    }
+  c->objs_per_slab = (PGSIZE - sizeof (struct slab)) / c->stride;
+  ASSERT (c->objs_per_slab >= 2);
+
+  lock_init (&c->lock);
+  list_init (&c->full);
+  list_init (&c->partial);
+  list_init (&c->empty);
+  c->slab_cnt = c->in_use = c->peak_in_use = 0;
+  c->alloc_cnt = c->ctor_cnt = 0;
+
+  if (!inited)
+    {
+      lock_init (&all_caches_lock);
+      inited = true;
+    }
+  lock_acquire (&all_caches_lock);
+  list_push_back (&all_caches, &c->elem);
+  lock_release (&all_caches_lock);
+
+  return c;
+}
+
+/* Allocates a new slab for C, constructs its objects and puts
+   it on C's empty list.  Returns false if no page is available.
+   C's lock must be held. */
+static bool
+slab_create (struct kmem_cache *c)
+{
+  struct slab *s = palloc_get_page (0);
+  uint8_t *obj;
+  size_t i;
+
+  if (s == NULL)
+    return false;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->in_use = 0;
+  s->free = NULL;
+
+  /* Link the objects in address order. */
+  obj = (uint8_t *) (s + 1) + c->objs_per_slab * c->stride;
+  for (i = 0; i < c->objs_per_slab; i++)
+    {
+      obj -= c->stride;
+      if (c->ctor != NULL)
+        {
+          c->ctor (obj);
+          c->ctor_cnt++;
+        }
+      *free_link (c, obj) = s->free;
+      s->free = obj;
+    }
+
+  list_push_back (&c->empty, &s->elem);
+  c->slab_cnt++;
+  return true;
+}
+
+/* Obtains and returns a new object from C, in the state its
+   constructor (if any) left it.  Returns a null pointer if
+   memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&c->lock);
+
+  if (list_empty (&c->partial) && list_empty (&c->empty)
+      && !slab_create (c))
+    {
+      lock_release (&c->lock);
+      return NULL;
+    }
+
+  /* Prefer partially used slabs, so that free ones stay free. */
+  if (!list_empty (&c->partial))
+    s = list_entry (list_front (&c->partial), struct slab, elem);
+  else
+    {
+      s = list_entry (list_pop_front (&c->empty), struct slab, elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  obj = s->free;
+  s->free = *free_link (c, obj);
+  if (++s->in_use == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->full, &s->elem);
+    }
+
+  c->alloc_cnt++;
+  if (++c->in_use > c->peak_in_use)
+    c->peak_in_use = c->in_use;
+
+  lock_release (&c->lock);
+  return obj;
+}
+
+/* Like kmem_cache_alloc(), but zeroes the object.  Only for
+   caches without a constructor. */
+void *
+kmem_cache_zalloc (struct kmem_cache *c)
+{
+  void *obj;
+
+  ASSERT (c->ctor == NULL);
+
+  obj = kmem_cache_alloc (c);
+  if (obj != NULL)
+    memset (obj, 0, c->obj_size);
+  return obj;
+}
+
+/* Returns OBJ, which must have been allocated from C, to C.
+   Does nothing if OBJ is a null pointer. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  struct slab *s;
+
+  if (obj == NULL)
+    return;
+
+  s = pg_round_down (obj);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it must keep its constructed state. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+
+  *free_link (c, obj) = s->free;
+  s->free = obj;
+  if (s->in_use-- == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      list_push_front (&c->partial, &s->elem);
+    }
+  if (s->in_use == 0)
+    {
+      list_remove (&s->elem);
+      if (list_empty (&c->empty))
+        list_push_front (&c->empty, &s->elem);
+      else
+        {
+          palloc_free_page (s);
+          c->slab_cnt--;
+        }
+    }
+  c->in_use--;
+
+  lock_release (&c->lock);
+}
+
+/* Prints statistics for every object cache. */
+void
+kmem_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      printf ("Slab %s: %zu-byte objects, %zu in use (peak %zu), "
+              "%zu slabs, %llu allocs, %llu ctor calls\n",
+              c->name, c->obj_size, c->in_use, c->peak_in_use,
+              c->slab_cnt, c->alloc_cnt, c->ctor_cnt);
+    }
+}
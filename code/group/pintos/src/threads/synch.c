@@ -27,11 +27,75 @@
 */
 
 #include "threads/synch.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 
+/* Semaphores and locks take an uncontended fast path that does
+   not disable interrupts or touch the waiter list: the value or
+   owner word is updated with a single compare-and-exchange.
+   Only a thread that has to wait disables interrupts, rechecks
+   the word, and queues itself.  The releasing side updates the
+   word first and only then looks for waiters, so a thread that
+   queued itself before the update is always woken, and one that
+   checks after the update sees it and does not sleep.
+
+   Pintos runs on a single CPU, so an instruction that reads and
+   writes memory is atomic with respect to interrupts without a
+   LOCK prefix. */
+
+/* If *P equals OLD, atomically replaces it by NEW and returns
+   true.  Otherwise returns false.  See [IA32-v2a] "CMPXCHG". */
+static inline bool
+compare_and_swap (volatile uintptr_t *p, uintptr_t old, uintptr_t new)
+{
+  uintptr_t prev;
+
+  asm volatile ("cmpxchgl %2, %1"
+                : "=a" (prev), "+m" (*p)
+                : "r" (new), "0" (old)
+                : "cc", "memory");
+  return prev == old;
+}
+
+/* Decrements SEMA's value and returns true if it is positive,
+   otherwise returns false. */
+static bool
+sema_dec (struct semaphore *sema)
+{
+  volatile uintptr_t *value = (volatile uintptr_t *) &sema->value;
+  uintptr_t old;
+
+  do
+    {
+      old = *value;
+      if (old == 0)
+        return false;
+    }
+  while (!compare_and_swap (value, old, old - 1));
+  return true;
+}
+
+/* Wakes up the first thread in WAITERS, if any. */
+static void
+wake_one (struct list *waiters)
+{
+  enum intr_level old_level;
+
+  /* The unlocked check is only a hint: it avoids disabling
+     interrupts in the common case of no waiters. */
+  if (list_empty (waiters))
+    return;
+
+  old_level = intr_disable ();
+  if (!list_empty (waiters))
+    thread_unblock (list_entry (list_pop_front (waiters),
+                                struct thread, elem));
+  intr_set_level (old_level);
+}
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -65,13 +129,15 @@ sema_down (struct semaphore *sema)
   ASSERT (sema != NULL);
   ASSERT (!intr_context ());
 
+  if (sema_dec (sema))
+    return;
+
   old_level = intr_disable ();
-  while (sema->value == 0) 
+  while (!sema_dec (sema))
     {
       list_push_back (&sema->waiters, &thread_current ()->elem);
       thread_block ();
     }
-  sema->value--;
   intr_set_level (old_level);
 }
 
@@ -83,22 +149,9 @@ sema_down (struct semaphore *sema)
 bool
 sema_try_down (struct semaphore *sema) 
 {
-  enum intr_level old_level;
-  bool success;
-
   ASSERT (sema != NULL);
 
-  old_level = intr_disable ();
-  if (sema->value > 0) 
-    {
-      sema->value--;
-      success = true; 
-    }
-  else
-    success = false;
-  intr_set_level (old_level);
-
-  return success;
+  return sema_dec (sema);
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
@@ -108,16 +161,10 @@ sema_try_down (struct semaphore *sema)
 void
 sema_up (struct semaphore *sema) 
 {
-  enum intr_level old_level;
-
   ASSERT (sema != NULL);
 
-  old_level = intr_disable ();
-  if (!list_empty (&sema->waiters)) 
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
-  sema->value++;
-  intr_set_level (old_level);
+  asm volatile ("incl %0" : "+m" (sema->value) : : "cc", "memory");
+  wake_one (&sema->waiters);
 }
 
 static void sema_test_helper (void *sema_);
@@ -162,9 +209,11 @@ sema_test_helper (void *sema_)
    is, it is an error for the thread currently holding a lock to
    try to acquire that lock.
 
-   A lock is a specialization of a semaphore with an initial
-   value of 1.  The difference between a lock and such a
-   semaphore is twofold.  First, a semaphore can have a value
+   A lock behaves like a semaphore with an initial value of 1,
+   but keeps its owner in place of the value, so that acquiring
+   it is a single compare-and-exchange of the owner word.  The
+   difference between a lock and such a semaphore is
+   twofold.  First, a semaphore can have a value
    greater than 1, but a lock can only be owned by a single
    thread at a time.  Second, a semaphore does not have an owner,
    meaning that one thread can "down" the semaphore and then
@@ -178,7 +227,19 @@ lock_init (struct lock *lock)
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
-  sema_init (&lock->semaphore, 1);
+  list_init (&lock->waiters);
+  lock->acquire_cnt = 0;
+  lock->contend_cnt = 0;
+}
+
+/* Makes the current thread LOCK's holder and returns true if
+   LOCK is free, otherwise returns false. */
+static inline bool
+lock_take (struct lock *lock)
+{
+  return compare_and_swap ((volatile uintptr_t *) &lock->holder,
+                           (uintptr_t) NULL,
+                           (uintptr_t) thread_current ());
 }
 
 /* Acquires LOCK, sleeping until it becomes available if
@@ -196,8 +257,20 @@ lock_acquire (struct lock *lock)
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
-  sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  if (!lock_take (lock))
+    {
+      enum intr_level old_level = intr_disable ();
+      while (!lock_take (lock))
+        {
+          list_push_back (&lock->waiters, &thread_current ()->elem);
+          thread_block ();
+        }
+      intr_set_level (old_level);
+
+      /* The counters are only updated by the holder. */
+      lock->contend_cnt++;
+    }
+  lock->acquire_cnt++;
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -214,9 +287,9 @@ lock_try_acquire (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
-  success = sema_try_down (&lock->semaphore);
+  success = lock_take (lock);
   if (success)
-    lock->holder = thread_current ();
+    lock->acquire_cnt++;
   return success;
 }
 
@@ -231,8 +304,10 @@ lock_release (struct lock *lock)
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  barrier ();
   lock->holder = NULL;
-  sema_up (&lock->semaphore);
+  barrier ();
+  wake_one (&lock->waiters);
 }
 
 /* Returns true if the current thread holds LOCK, false
@@ -245,6 +320,17 @@ lock_held_by_current_thread (const struct lock *lock)
 
   return lock->holder == thread_current ();
 }
+
+/* Prints how often LOCK, called NAME, was acquired and how
+   often that meant waiting for another thread. */
+void
+lock_print_stats (const struct lock *lock, const char *name)
+{
+  ASSERT (lock != NULL);
+
+  printf ("Lock %s: %u acquires, %u contended\n",
+          name, lock->acquire_cnt, lock->contend_cnt);
+}
 
 /* One semaphore in a list. */
 struct semaphore_elem 
@@ -336,3 +422,171 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes readers-writer lock RW.  Any number of threads
+   may hold RW for reading at once, or a single thread may hold
+   it for writing.  Writers are preferred: once a writer is
+   waiting, new readers wait behind it, so a steady stream of
+   readers cannot starve writers out.
+
+   Like a lock, RW must be released by the thread that acquired
+   it, and it is not recursive: a thread holding RW in either
+   mode must not try to acquire it again, because a writer
+   waiting in between would deadlock it. */
+void
+rwlock_init (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_init (&rw->lock);
+  cond_init (&rw->can_read);
+  cond_init (&rw->can_write);
+  rw->reader_cnt = 0;
+  rw->writer_wait_cnt = 0;
+  rw->writer = NULL;
+}
+
+/* Acquires RW for reading, sleeping while a thread holds it for
+   writing or is waiting to.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  while (rw->writer != NULL || rw->writer_wait_cnt > 0)
+    cond_wait (&rw->can_read, &rw->lock);
+  rw->reader_cnt++;
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  lock_acquire (&rw->lock);
+  ASSERT (rw->reader_cnt > 0);
+  if (--rw->reader_cnt == 0 && rw->writer_wait_cnt > 0)
+    cond_signal (&rw->can_write, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Acquires RW for writing, sleeping until no other thread holds
+   it in either mode.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (!rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  rw->writer_wait_cnt++;
+  while (rw->writer != NULL || rw->reader_cnt > 0)
+    cond_wait (&rw->can_write, &rw->lock);
+  rw->writer_wait_cnt--;
+  rw->writer = thread_current ();
+  lock_release (&rw->lock);
+}
+
+/* Releases RW, which the current thread holds for writing.
+   Hands RW to the next waiting writer if there is one, and
+   otherwise lets all waiting readers in. */
+void
+rwlock_release_write (struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+  ASSERT (rwlock_held_for_write (rw));
+
+  lock_acquire (&rw->lock);
+  rw->writer = NULL;
+  if (rw->writer_wait_cnt > 0)
+    cond_signal (&rw->can_write, &rw->lock);
+  else
+    cond_broadcast (&rw->can_read, &rw->lock);
+  lock_release (&rw->lock);
+}
+
+/* Returns true if the current thread holds RW for writing,
+   false otherwise. */
+bool
+rwlock_held_for_write (const struct rwlock *rw)
+{
+  ASSERT (rw != NULL);
+
+  return rw->writer == thread_current ();
+}
+
+/* State shared by rwlock_self_test() and its helper threads. */
+struct rwlock_test
+  {
+    struct rwlock rw;           /* Lock under test. */
+    struct semaphore done;      /* Upped by each helper when done. */
+    bool wrote;                 /* Set by the writer helper. */
+  };
+
+static void rwlock_test_reader (void *test_);
+static void rwlock_test_writer (void *test_);
+
+/* Self-test for readers-writer locks.  Checks that a second
+   reader gets in while the lock is held for reading, and that a
+   writer does not get in until the last reader leaves. */
+void
+rwlock_self_test (void)
+{
+  struct rwlock_test test;
+  int i;
+
+  printf ("Testing rwlocks...");
+  rwlock_init (&test.rw);
+  sema_init (&test.done, 0);
+  test.wrote = false;
+
+  /* Readers share.  This deadlocks if the helper cannot get in
+     while we hold the lock. */
+  rwlock_acquire_read (&test.rw);
+  thread_create ("rwlock-reader", PRI_DEFAULT, rwlock_test_reader, &test);
+  sema_down (&test.done);
+
+  /* Writers exclude readers. */
+  thread_create ("rwlock-writer", PRI_DEFAULT, rwlock_test_writer, &test);
+  for (i = 0; i < 10; i++)
+    thread_yield ();
+  ASSERT (!test.wrote);
+  rwlock_release_read (&test.rw);
+  sema_down (&test.done);
+  ASSERT (test.wrote);
+
+  printf ("done.\n");
+}
+
+/* Reader thread function used by rwlock_self_test(). */
+static void
+rwlock_test_reader (void *test_)
+{
+  struct rwlock_test *test = test_;
+
+  rwlock_acquire_read (&test->rw);
+  rwlock_release_read (&test->rw);
+  sema_up (&test->done);
+}
+
+/* Writer thread function used by rwlock_self_test(). */
+static void
+rwlock_test_writer (void *test_)
+{
+  struct rwlock_test *test = test_;
+
+  rwlock_acquire_write (&test->rw);
+  test->wrote = true;
+  rwlock_release_write (&test->rw);
+  sema_up (&test->done);
+}
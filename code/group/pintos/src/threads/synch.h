@@ -20,8 +20,10 @@ void sema_self_test (void);
 /* Lock. */
 struct lock 
   {
-    struct thread *holder;      /* Thread holding lock (for debugging). */
-    struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct thread *holder;      /* Thread holding lock, or null. */
+    struct list waiters;        /* List of waiting threads. */
+    unsigned acquire_cnt;       /* Number of times acquired. */
+    unsigned contend_cnt;       /* Acquisitions that had to wait. */
   };
 
 void lock_init (struct lock *);
@@ -29,6 +31,7 @@ void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
 bool lock_held_by_current_thread (const struct lock *);
+void lock_print_stats (const struct lock *, const char *name);
 
 /* Condition variable. */
 struct condition 
@@ -41,6 +44,25 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition can_read;  /* Signaled when readers may enter. */
+    struct condition can_write; /* Signaled when a writer may enter. */
+    unsigned reader_cnt;        /* Number of threads reading. */
+    unsigned writer_wait_cnt;   /* Number of threads waiting to write. */
+    struct thread *writer;      /* Thread writing, or null. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+bool rwlock_held_for_write (const struct rwlock *);
+void rwlock_self_test (void);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
@@ -8,6 +8,7 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -28,6 +29,10 @@ static struct list ready_list;
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
+/* Cache of struct wait, shared by a parent and a child thread. */
+static struct kmem_cache *wait_cache;
+static kmem_ctor_func wait_ctor;
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -105,6 +110,8 @@ thread_init (void)
 void
 thread_start (void) 
 {
+  wait_cache = kmem_cache_create ("wait", sizeof (struct wait), wait_ctor);
+
   /* Create the idle thread. */
   struct semaphore idle_started;
   sema_init (&idle_started, 0);
@@ -200,13 +207,12 @@ thread_create (const char *name, int priority,
   sf->ebp = 0;
 
   /* create an wait struct */
-  wait = malloc (sizeof(struct wait));
+  wait = kmem_cache_alloc (wait_cache);
 
-  /* init the wait struct*/
+  /* init the wait struct (ref_lock is set up by wait_ctor) */
   wait->child_tid = tid;
   sema_init (&wait->sema, 0);
   wait->ref_count = 2;
-  lock_init (&wait->ref_lock);
   wait->exit_code = -1;
   wait->wait_count=0;
   sema_init (&wait->exec_sema, 0);
@@ -222,6 +228,15 @@ thread_create (const char *name, int priority,
   return tid;
 }
 
+/* Constructs struct wait W.  Its lock is always released before
+   W is freed, so it only needs to be initialized once. */
+static void
+wait_ctor (void *w_)
+{
+  struct wait *w = w_;
+  lock_init (&w->ref_lock);
+}
+
 /* Puts the current thread to sleep.  It will not be scheduled
    again until awoken by thread_unblock().
 
@@ -326,7 +341,7 @@ thread_exit (void)
       /* Remove wait struct if re_count is 0 */ 
       if (cur->parent_wait->ref_count==0)
       {
-        free (cur->parent_wait);
+        kmem_cache_free (wait_cache, cur->parent_wait);
       }
     } 
 
@@ -351,7 +366,7 @@ thread_exit (void)
       if(w->ref_count==0)
       {
         list_remove (&w->elem);
-        free (w);
+        kmem_cache_free (wait_cache, w);
       }
     }
 
@@ -539,7 +554,11 @@ init_thread (struct thread *t, const char *name, int priority)
   /*by group 51*/
   list_init(&t->wait_list); 
   t->parent_wait = NULL;
-  memset(t->fd_table, 0, sizeof (t->fd_table));
+  t->fd_table = NULL;
+  t->exec_file = NULL;
+#ifdef VM
+  list_init (&t->segments);
+#endif
 
   /* inherit partent's cwd */
   if (is_filesys_init == true)
@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <list.h>
 #include <stdint.h>
+#include <syscall-types.h>
 #include "threads/synch.h"
 #include "threads/fixed-point.h"
 #include "filesys/directory.h"
@@ -34,6 +35,9 @@ struct fd_entry
     void *fd_pointer;
     int type;
   };
+
+struct fd_table;
+struct file;
   
 /* A kernel thread or user process.
 
@@ -113,14 +117,22 @@ struct thread
     struct list wait_list;              /* list of wait structs */
 #endif
 
+#ifdef VM
+    /* Owned by vm/page.c. */
+    struct list segments;               /* Lazily loaded executable segments. */
+#endif
+
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
     
     /* by group 51 */
-    struct fd_entry *fd_table[129];     /* Stores all fds. Extra index for recent executable file. */
+    struct fd_table *fd_table;          /* Open fds, allocated on first open. */
+    struct file *exec_file;             /* Running executable, denied writes. */
 
     /* pj3 */
     struct dir *cwd;                    /* current working directory */
+    int journal_depth;                  /* Open journal transactions. */
+    struct cache_stat cache_stat;       /* Buffer cache accesses. */
   };
 
 struct wait
@@ -4,6 +4,10 @@
 #include "userprog/gdt.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 /* Number of page faults processed. */
 static long long page_fault_cnt;
@@ -65,6 +69,16 @@ void
 exception_print_stats (void) 
 {
   printf ("Exception: %lld page faults\n", page_fault_cnt);
+#ifdef VM
+  page_print_stats ();
+#endif
+}
+
+/* Returns the number of page faults processed so far. */
+long long
+exception_page_fault_cnt (void)
+{
+  return page_fault_cnt;
 }
 
 /* Handler for an exception (probably) caused by a user process. */
@@ -149,6 +163,13 @@ page_fault (struct intr_frame *f)
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
 
+#ifdef VM
+  /* Bring in a demand-loaded executable page, whether the user
+     process touched it or the kernel did on its behalf. */
+  if (not_present && is_user_vaddr (fault_addr) && page_fault_in (fault_addr))
+    return;
+#endif
+
   /* To implement virtual memory, delete the rest of the function
      body, and replace it with code that brings in the page to
      which fault_addr refers. */
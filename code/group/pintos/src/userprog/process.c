@@ -5,58 +5,304 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <bitmap.h>
 #include "userprog/gdt.h"
 #include "userprog/pagedir.h"
 #include "userprog/tss.h"
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/journal.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
+
+/* A new process's command line, tokenized once by
+   process_execute() into the exact bytes that setup_stack()
+   copies to the top of the user stack: a fake return address,
+   argc, argv, the argv[] array and the word-aligned argument
+   strings, with argv[] already holding the strings' final user
+   addresses.  The header sits at the start of a page and the
+   image fills the end of the same page. */
+struct exec_args
+  {
+    size_t size;                /* Bytes in the image. */
+    const char *file_name;      /* argv[0], within the image. */
+  };
 
 static thread_func start_process NO_RETURN;
-static bool load (const char *cmdline, void (**eip) (void), void **esp);
+static bool load (const struct exec_args *, void (**eip) (void), void **esp);
+
+/* Initial number of slots in an fd table.  The table doubles in
+   size whenever every slot is taken. */
+#define FD_TABLE_INIT_SIZE 32
+
+/* A process's table of open fds, kept outside `struct thread' so
+   that it does not eat into the kernel stack and can grow without
+   bound. */
+struct fd_table
+  {
+    struct fd_entry **entries;          /* Open fds, indexed by fd. */
+    struct bitmap *used;                /* Set bits mark fds in use. */
+    size_t size;                        /* Number of slots. */
+    size_t lowest_free;                 /* No fd below this is free. */
+  };
+
+/* Cache of fd table entries. */
+static struct kmem_cache *fd_entry_cache;
+
+/* Initializes the user process module. */
+void
+process_init (void)
+{
+  fd_entry_cache = kmem_cache_create ("fd_entry", sizeof (struct fd_entry),
+                                      NULL);
+}
+
+/* Returns a new, uninitialized fd table entry, or a null pointer
+   if memory is not available. */
+struct fd_entry *
+fd_entry_alloc (void)
+{
+  return kmem_cache_alloc (fd_entry_cache);
+}
+
+/* Frees FD_ENTRY, obtained from fd_entry_alloc(). */
+void
+fd_entry_free (struct fd_entry *fd_entry)
+{
+  kmem_cache_free (fd_entry_cache, fd_entry);
+}
+
+/* Allocates an empty fd table with SIZE slots.  fds 0 and 1 are
+   reserved for the console.  Returns a null pointer if memory
+   allocation fails. */
+static struct fd_table *
+fd_table_create (size_t size)
+{
+  struct fd_table *table = malloc (sizeof *table);
+  if (table == NULL)
+    return NULL;
+
+  table->entries = calloc (size, sizeof *table->entries);
+  table->used = bitmap_create (size);
+  if (table->entries == NULL || table->used == NULL)
+    {
+      free (table->entries);
+      if (table->used != NULL)
+        bitmap_destroy (table->used);
+      free (table);
+      return NULL;
+    }
+  bitmap_set_multiple (table->used, 0, 2, true);
+  table->size = size;
+  table->lowest_free = 2;
+  return table;
+}
+
+/* Doubles the number of slots in TABLE, which must be full.
+   Returns true if successful, false if memory allocation fails. */
+static bool
+fd_table_grow (struct fd_table *table)
+{
+  size_t new_size = table->size * 2;
+  struct fd_entry **entries;
+  struct bitmap *used;
 
-/* Returns the first (lowest value) available (unused) fd.
-   If there isn't one available, returns -1. 
+  used = bitmap_create (new_size);
+  if (used == NULL)
+    return false;
+  entries = realloc (table->entries, new_size * sizeof *entries);
+  if (entries == NULL)
+    {
+      bitmap_destroy (used);
+      return false;
+    }
+
+  memset (entries + table->size, 0,
+          (new_size - table->size) * sizeof *entries);
+  bitmap_set_multiple (used, 0, table->size, true);
+  bitmap_destroy (table->used);
+
+  table->entries = entries;
+  table->used = used;
+  table->lowest_free = table->size;
+  table->size = new_size;
+  return true;
+}
+
+/* Stores FD_ENTRY in the current process's fd table under the
+   lowest unused fd and returns that fd.
+   Returns -1 if memory allocation fails.
    Added by Group 51. */
 int
-first_avail_fd (struct fd_entry *fd_table[])
+fd_install (struct fd_entry *fd_entry)
 {
-  int i;
-  /* fds 0 and 1 are reserved */
-  for (i = 2; i < 128; i++) 
+  struct thread *t = thread_current ();
+  struct fd_table *table = t->fd_table;
+  size_t fd;
+
+  if (table == NULL)
+    {
+      table = t->fd_table = fd_table_create (FD_TABLE_INIT_SIZE);
+      if (table == NULL)
+        return -1;
+    }
+
+  fd = bitmap_scan_and_flip (table->used, table->lowest_free, 1, false);
+  if (fd == BITMAP_ERROR)
+    {
+      if (!fd_table_grow (table))
+        return -1;
+      fd = bitmap_scan_and_flip (table->used, table->lowest_free, 1, false);
+    }
+
+  table->entries[fd] = fd_entry;
+  table->lowest_free = fd + 1;
+  return fd;
+}
+
+/* Returns the entry for FD in the current process's fd table, or
+   a null pointer if FD is not open. */
+struct fd_entry *
+fd_get (int fd)
+{
+  struct fd_table *table = thread_current ()->fd_table;
+
+  if (table == NULL || fd < 0 || (size_t) fd >= table->size)
+    return NULL;
+  return table->entries[fd];
+}
+
+/* Removes FD from the current process's fd table and returns its
+   entry, which the caller must close and free, or a null pointer
+   if FD is not open. */
+struct fd_entry *
+fd_remove (int fd)
+{
+  struct fd_table *table = thread_current ()->fd_table;
+  struct fd_entry *fd_entry = fd_get (fd);
+
+  if (fd_entry != NULL)
     {
-      if (fd_table[i] == NULL)
-        return i;
+      table->entries[fd] = NULL;
+      bitmap_reset (table->used, fd);
+      if ((size_t) fd < table->lowest_free)
+        table->lowest_free = fd;
     }
-  return -1;
+  return fd_entry;
 }
 
-/* Closes all open files in thread's fd_table */
+/* Closes all open files and directories in the current process's
+   fd table and frees the table. */
 void
-file_close_all (struct fd_entry *fd_table[])
+file_close_all (void)
 {
-  int i;
-  for (i = 2; i < 128; i++) 
+  struct thread *t = thread_current ();
+  struct fd_table *table = t->fd_table;
+  size_t fd;
+
+  if (table == NULL)
+    return;
+
+  for (fd = 2; fd < table->size; fd++)
     {
-      struct fd_entry* fd_entry = fd_table[i];
-      if (fd_entry != NULL && fd_entry->type == 0)
+      struct fd_entry *fd_entry = table->entries[fd];
+      if (fd_entry == NULL)
+        continue;
+      if (fd_entry->type == 0)
         file_close ((struct file *) fd_entry->fd_pointer);
-        free (fd_table[i]);
+      else
+        dir_close ((struct dir *) fd_entry->fd_pointer);
+      fd_entry_free (fd_entry);
     }
+
+  bitmap_destroy (table->used);
+  free (table->entries);
+  free (table);
+  t->fd_table = NULL;
+}
+
+/* Returns the start of ARGS's stack image. */
+static uint8_t *
+exec_args_image (const struct exec_args *args)
+{
+  return (uint8_t *) args + PGSIZE - args->size;
 }
 
-struct argument
+/* Splits CMD_LINE into words and lays them out as a stack image
+   in a new page, as described above struct exec_args.  Each word
+   is scanned and copied exactly once.  Returns the new page, or a
+   null pointer if CMD_LINE has no words, does not fit in a page,
+   or no page is available. */
+static struct exec_args *
+exec_args_create (const char *cmd_line)
 {
-  struct list_elem elem;
-  char* argument;
-};
+  struct exec_args *args = palloc_get_page (0);
+  uint8_t *end, *pos;
+  char **words;
+  size_t argc = 0, pad, i;
+
+  if (args == NULL)
+    return NULL;
+
+  /* Copy the words down from the end of the page.  Their user
+     addresses are collected in WORDS, just past the header. */
+  end = pos = (uint8_t *) args + PGSIZE;
+  words = (char **) (args + 1);
+  while (*cmd_line != '\0')
+    {
+      size_t len;
+
+      if (*cmd_line == ' ')
+        {
+          cmd_line++;
+          continue;
+        }
+      len = strcspn (cmd_line, " ");
+      if ((uint8_t *) (words + argc + 1) + len + 1 > pos)
+        goto fail;
+      pos -= len + 1;
+      memcpy (pos, cmd_line, len);
+      pos[len] = '\0';
+      words[argc++] = (char *) PHYS_BASE - (end - pos);
+      cmd_line += len;
+    }
+  if (argc == 0)
+    goto fail;
+  args->file_name = (char *) end - ((char *) PHYS_BASE - words[0]);
+
+  /* Word-align, then add argv[] with its null terminator, argv,
+     argc, and the return address. */
+  pad = pg_ofs (pos) % sizeof (uint32_t);
+  if ((uint8_t *) (words + argc) + pad + (argc + 4) * sizeof (uint32_t) > pos)
+    goto fail;
+  pos -= pad;
+  memset (pos, 0, pad);
+  pos -= (argc + 4) * sizeof (uint32_t);
+  ((uint32_t *) pos)[0] = 0;
+  ((uint32_t *) pos)[1] = argc;
+  ((uint32_t *) pos)[2] = (uint32_t) PHYS_BASE - (end - pos) + 12;
+  for (i = 0; i < argc; i++)
+    ((char **) pos)[3 + i] = words[i];
+  ((char **) pos)[3 + argc] = NULL;
+
+  args->size = end - pos;
+  return args;
+
+ fail:
+  palloc_free_page (args);
+  return NULL;
+}
 
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
@@ -65,34 +311,20 @@ struct argument
 tid_t
 process_execute (const char *file_name) 
 {
-  char *fn_copy;
+  struct exec_args *args;
   tid_t tid;
 
-  /* Make a copy of FILE_NAME.
-     Otherwise there's a race between the caller and load(). */
-  fn_copy = palloc_get_page (0);
-
-  if (fn_copy == NULL)
+  /* Build the new stack image here, from FILE_NAME, so that
+     there is no race between the caller and load() and the child
+     has nothing left to parse. */
+  args = exec_args_create (file_name);
+  if (args == NULL)
     return TID_ERROR;
 
-  char exec_name[16];
-  char* temp = strchr(file_name, ' ');
-
-  if (temp == NULL)
-  {
-    strlcpy(exec_name, file_name, strlen(file_name)+1);
-  }
-  else 
-  {
-    strlcpy(exec_name, file_name, temp - file_name + 1);
-  }
-
-  strlcpy (fn_copy, file_name, PGSIZE);
-
   /* Create a new thread to execute FILE_NAME. */
-  tid = thread_create (exec_name, PRI_DEFAULT, start_process, fn_copy);
+  tid = thread_create (args->file_name, PRI_DEFAULT, start_process, args);
   if (tid == TID_ERROR)
-    palloc_free_page (fn_copy);
+    palloc_free_page (args);
 
 
   /* by group 51 */
@@ -118,9 +350,9 @@ process_execute (const char *file_name)
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *args_)
 {
-  char *file_name = file_name_;
+  struct exec_args *args = args_;
   struct intr_frame if_;
   bool success;
 
@@ -129,14 +361,14 @@ start_process (void *file_name_)
   if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
   if_.cs = SEL_UCSEG;
   if_.eflags = FLAG_IF | FLAG_MBS;
-  success = load (file_name, &if_.eip, &if_.esp);
+  success = load (args, &if_.eip, &if_.esp);
 
   /* update load_success and sema_up */
   thread_current()->parent_wait->load_success = success;
   sema_up(&thread_current()->parent_wait->exec_sema);
 
   /* If load failed, quit. */
-  palloc_free_page (file_name);
+  palloc_free_page (args);
   if (!success) 
     thread_exit ();
 
@@ -200,6 +432,21 @@ process_exit (void)
   struct thread *cur = thread_current ();
   uint32_t *pd;
 
+  /* End the transaction of a system call that was cut short,
+     then close files as a transaction of their own. */
+  journal_exit ();
+  journal_begin ();
+  file_close_all ();
+
+#ifdef VM
+  page_destroy_segments ();
+#endif
+
+  /* Closing the executable allows writes to it again. */
+  file_close (cur->exec_file);
+  cur->exec_file = NULL;
+  journal_end ();
+
   /* Destroy the current process's page directory and switch back
      to the kernel-only page directory. */
   pd = cur->pagedir;
@@ -297,18 +544,19 @@ struct Elf32_Phdr
 #define PF_W 2          /* Writable. */
 #define PF_R 4          /* Readable. */
 
-static bool setup_stack (void **esp, char*);
+static bool setup_stack (void **esp, const struct exec_args *);
 static bool validate_segment (const struct Elf32_Phdr *, struct file *);
 static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
+/* Loads the ELF executable named by ARGS into the current
+   thread, with ARGS as its arguments.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp) 
+load (const struct exec_args *args, void (**eip) (void), void **esp) 
 {
   struct thread *t = thread_current ();
   struct Elf32_Ehdr ehdr;
@@ -323,20 +571,11 @@ load (const char *file_name, void (**eip) (void), void **esp)
     goto done;
   process_activate ();
 
-  //by group 51
-  //get a file name from the command line
-  char *token, *arg_ptr;
-
-  char* copy = (char *) malloc (strlen(file_name) + 1);
-  strlcpy(copy, file_name, strlen(file_name) + 1);
-
-  token = strtok_r ((char *) file_name, " ", &arg_ptr);
-
   /* Open executable file. */
-  file = filesys_open (token);
+  file = filesys_open (args->file_name);
   if (file == NULL) 
     {
-      printf ("load: %s: open failed\n", token);
+      printf ("load: %s: open failed\n", args->file_name);
       goto done; 
     }
   
@@ -350,7 +589,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
       || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)
       || ehdr.e_phnum > 1024) 
     {
-      printf ("load: %s: error loading executable\n", token);
+      printf ("load: %s: error loading executable\n", args->file_name);
       goto done; 
     }
 
@@ -414,11 +653,9 @@ load (const char *file_name, void (**eip) (void), void **esp)
     }
 
   /* Set up stack. */
-  if (!setup_stack (esp, copy))
+  if (!setup_stack (esp, args))
     goto done;
 
-  free (copy);
-  
   /* Start address. */
   *eip = (void (*) (void)) ehdr.e_entry;
 
@@ -429,12 +666,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
   if (file != NULL) 
     {
       file_deny_write (file);
-      struct fd_entry* fd_entry;
-      fd_entry = malloc (sizeof (struct fd_entry));
-      fd_entry->fd_pointer = file;
-      fd_entry->type = 0;
-      thread_current ()->fd_table[128] = fd_entry;
-
+      thread_current ()->exec_file = file;
     } 
   else
       file_close (file);
@@ -503,6 +735,9 @@ validate_segment (const struct Elf32_Phdr *phdr, struct file *file)
    The pages initialized by this function must be writable by the
    user process if WRITABLE is true, read-only otherwise.
 
+   With VM, nothing is read here: the segment is only recorded and
+   its pages are brought in by page faults (see vm/page.c).
+
    Return true if successful, false if a memory allocation error
    or disk read error occurs. */
 static bool
@@ -513,6 +748,11 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   ASSERT (pg_ofs (upage) == 0);
   ASSERT (ofs % PGSIZE == 0);
 
+#ifdef VM
+  return page_add_segment (file, ofs, upage, read_bytes, zero_bytes,
+                           writable);
+#endif
+
   file_seek (file, ofs);
   while (read_bytes > 0 || zero_bytes > 0) 
     {
@@ -550,81 +790,27 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
   return true;
 }
 
-/* Create a minimal stack by mapping a zeroed page at the top of
-   user virtual memory. */
+/* Create a minimal stack by mapping a page at the top of user
+   virtual memory and copying ARGS's prebuilt image to its end. */
 static bool
-setup_stack (void **esp, char *file_name) 
+setup_stack (void **esp, const struct exec_args *args) 
 {
   uint8_t *kpage;
   bool success = false;
 
-  kpage = palloc_get_page (PAL_USER | PAL_ZERO);
+  kpage = palloc_get_page (PAL_USER);
   if (kpage != NULL) 
     {
       success = install_page (((uint8_t *) PHYS_BASE) - PGSIZE, kpage, true);
       if (success)
-      {
-
-        *esp = PHYS_BASE - 12;
-      }
-      else
-        palloc_free_page (kpage);
-
-        /* Added by group 51. */
-        int argc = 0;
-        char **argv = (char **) palloc_get_page (PAL_USER | PAL_ZERO);
-        char *token, *save_ptr;
-        int token_len;
- 
-        for (token = strtok_r(file_name, " ", &save_ptr); token != NULL;
-             token = strtok_r(NULL, " ", &save_ptr) )
         {
-          token_len = strlen(token);
-          /* +1 for '\0' */
-          *esp -= token_len + 1; 
-          memcpy(*esp, token, token_len + 1);
-
-          argv[argc] = *esp;
-
-          argc++;
+          memset (kpage, 0, PGSIZE - args->size);
+          memcpy (kpage + PGSIZE - args->size, exec_args_image (args),
+                  args->size);
+          *esp = PHYS_BASE - args->size;
         }
-
-      /* Word align the stack */
-      while ((int) *esp % 4 != 0)
-      {
-        char temp_zero = 0;
-        *esp -= sizeof(char);
-        memcpy(*esp, &temp_zero, sizeof(char));
-      }
-
-      /* Push 0 onto the stack for argv[last_pos] */
-      argv[argc] = 0;
-      *esp -= sizeof(char *);
-      memcpy(*esp, &argv[argc], sizeof(char *));
-
-      /* Assumes that argv for ls -l foo bar is like: ["ls", "-l", "foo", "bar"]*/
-      int i;
-      for (i = argc - 1; i > -1; i--)
-      {
-        *esp -= sizeof(char *);
-        memcpy(*esp, &argv[i], sizeof(char *));
-      }
-
-      /* Copy argv to the stack */
-      char* temp = *esp;
-      *esp -= sizeof(argv);
-      memcpy (*esp, &temp, sizeof(argv));
-
-      /* Copy argc to the stack */
-      *esp -= sizeof(int);
-      memcpy(*esp, &argc, sizeof(int));
-
-      /* Copy the return value to the stack */
-      int return_value = 0;
-      *esp -= sizeof(int);
-      memcpy(*esp, &return_value, sizeof(int));
-
-      palloc_free_page(argv);
+      else
+        palloc_free_page (kpage);
     }
   return success;
 }
@@ -6,8 +6,13 @@
 #include "filesys/file.h"
 
 /* Added by Group 51 */
-int first_avail_fd (struct fd_entry *fd_table[]);
-void file_close_all (struct fd_entry *fd_table[]);
+void process_init (void);
+struct fd_entry *fd_entry_alloc (void);
+void fd_entry_free (struct fd_entry *);
+int fd_install (struct fd_entry *fd_entry);
+struct fd_entry *fd_get (int fd);
+struct fd_entry *fd_remove (int fd);
+void file_close_all (void);
 
 tid_t process_execute (const char *file_name);
 int process_wait (tid_t);
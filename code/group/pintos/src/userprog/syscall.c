@@ -1,6 +1,7 @@
 #include "userprog/syscall.h"
 #include <stdio.h>
 #include <syscall-nr.h>
+#include <syscall-types.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "userprog/pagedir.h"   /* Added by Group 51 */
@@ -11,8 +12,16 @@
 #include "filesys/directory.h"  /* Added by Group 51 */
 #include <string.h>             /* Added by Group 51 */
 #include "filesys/inode.h"      /* Added by Group 51 */
+#include "filesys/journal.h"
 #include "threads/malloc.h"     /* Added by Group 51 */
+#include "threads/palloc.h"
+#include "threads/tsc.h"
+#include "threads/vaddr.h"
 #include "devices/block.h"
+#include "userprog/exception.h"
+#ifdef VM
+#include "vm/page.h"
+#endif
 
 static void syscall_handler (struct intr_frame *);
 
@@ -30,6 +39,14 @@ int open (const char *file);
 int read (int fd, void* buffer, unsigned size);
 int write (int fd, void* buffer, unsigned size);
 void close (int fd);
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int pread (int fd, void *buffer, unsigned size, off_t offset);
+int pwrite (int fd, const void *buffer, unsigned size, off_t offset);
+int copy_file_range (int fd_in, int fd_out, unsigned size);
+int fallocate (int fd, unsigned length);
+int fsync (int fd);
+int fdatasync (int fd);
 
 
 /* student testing-1 */
@@ -40,14 +57,107 @@ int get_cache_hit_count (void);
 /* student testing-2 */
 void get_stats (void);
 
+int get_page_fault_count (void);
+bool get_syscall_stat (int number, struct syscall_stat *stat);
+bool get_cache_stat (int fd, struct cache_stat *stat);
+
 
 bool chdir (const char *dir);
 bool mkdir (const char *dir);
 bool readdir (int fd, char *name);
+int readdir_batch (int fd, struct dirent *ents, unsigned size);
+bool stat (const char *file, struct stat *st);
 bool isdir (int fd);
 int inumber(int fd);
 
 void validate_mem (const void *uaddr);
+static uint8_t *user_to_kernel (const void *uaddr, bool write);
+static char *copy_in_string (const char *ustr);
+static struct dir *walk_path (const char *path, char name[NAME_MAX + 1]);
+static struct file *fd_file (int fd);
+static off_t file_user_io (struct file *, uint8_t *ubuf, off_t size,
+                           off_t offset, bool is_write);
+
+/* A system call handler.  ARGS points to the call's argument
+   words on the user stack, which have already been validated.
+   Returns the value to store in the caller's eax. */
+typedef uint32_t syscall_func (const uint32_t *args);
+
+/* Bit N of a syscall's PTR_ARGS is set if argument N is a user
+   pointer that must be mapped before the handler runs. */
+#define PTR(N) (1u << (N))
+
+/* Describes one system call. */
+struct syscall
+  {
+    syscall_func *func;                 /* Handler. */
+    int argc;                           /* Number of argument words. */
+    unsigned ptr_args;                  /* Arguments to validate, PTR(N). */
+    bool txn;                           /* Runs as a journal transaction. */
+  };
+
+static syscall_func sys_halt, sys_exit, sys_exec, sys_wait, sys_create,
+  sys_remove, sys_open, sys_filesize, sys_read, sys_write, sys_seek,
+  sys_tell, sys_close, sys_practice, sys_reset_cache_count,
+  sys_get_cache_read_count, sys_get_cache_hit_count, sys_get_stats,
+  sys_chdir, sys_mkdir, sys_readdir, sys_isdir, sys_inumber,
+  sys_readdir_batch, sys_stat,
+  sys_readv, sys_writev, sys_pread, sys_pwrite, sys_copy_file_range,
+  sys_fallocate, sys_fsync, sys_fdatasync, sys_get_page_fault_count,
+  sys_get_syscall_stat, sys_get_cache_stat;
+
+/* System call table, indexed by system call number.  Numbers
+   without a handler are ignored. */
+static const struct syscall syscalls[] =
+  {
+    [SYS_HALT] = {sys_halt, 0, 0},
+    [SYS_EXIT] = {sys_exit, 1, 0},
+    [SYS_EXEC] = {sys_exec, 1, PTR (0)},
+    [SYS_WAIT] = {sys_wait, 1, 0},
+    [SYS_CREATE] = {sys_create, 2, PTR (0), true},
+    [SYS_REMOVE] = {sys_remove, 1, PTR (0), true},
+    [SYS_OPEN] = {sys_open, 1, PTR (0)},
+    [SYS_FILESIZE] = {sys_filesize, 1, 0},
+    [SYS_READ] = {sys_read, 3, PTR (1)},
+    /* Transactions only for files, inside the handler, so that
+       console output never waits for a commit. */
+    [SYS_WRITE] = {sys_write, 3, PTR (1)},
+    [SYS_SEEK] = {sys_seek, 2, 0},
+    [SYS_TELL] = {sys_tell, 1, 0},
+    [SYS_CLOSE] = {sys_close, 1, 0, true},
+    [SYS_PRACTICE] = {sys_practice, 1, 0},
+    [SYS_TEST3] = {sys_reset_cache_count, 0, 0},
+    [SYS_TEST4] = {sys_get_cache_read_count, 0, 0},
+    [SYS_TEST5] = {sys_get_cache_hit_count, 0, 0},
+    [SYS_TEST6] = {sys_get_stats, 0, 0},
+    [SYS_CHDIR] = {sys_chdir, 1, PTR (0)},
+    [SYS_MKDIR] = {sys_mkdir, 1, PTR (0), true},
+    [SYS_READDIR] = {sys_readdir, 2, PTR (1)},
+    [SYS_ISDIR] = {sys_isdir, 1, 0},
+    [SYS_INUMBER] = {sys_inumber, 1, 0},
+    [SYS_READDIR_BATCH] = {sys_readdir_batch, 3, 0},
+    [SYS_STAT] = {sys_stat, 2, PTR (0)},
+    [SYS_READV] = {sys_readv, 3, 0},
+    [SYS_WRITEV] = {sys_writev, 3, 0},
+    [SYS_PREAD] = {sys_pread, 4, PTR (1)},
+    [SYS_PWRITE] = {sys_pwrite, 4, PTR (1), true},
+    [SYS_COPY_FILE_RANGE] = {sys_copy_file_range, 3, 0, true},
+    [SYS_FALLOCATE] = {sys_fallocate, 2, 0, true},
+    /* Not transactions: syncing commits the journal, which may
+       not happen inside one. */
+    [SYS_FSYNC] = {sys_fsync, 1, 0},
+    [SYS_FDATASYNC] = {sys_fdatasync, 1, 0},
+    [SYS_PAGE_FAULT_COUNT] = {sys_get_page_fault_count, 0, 0},
+    [SYS_SYSCALL_STAT] = {sys_get_syscall_stat, 2, PTR (1)},
+    [SYS_CACHE_STAT] = {sys_get_cache_stat, 2, PTR (1)},
+  };
+
+#define SYSCALL_CNT (sizeof syscalls / sizeof *syscalls)
+
+/* Invocation counts and cycle totals, indexed by system call
+   number.  Updated without locking, so concurrent calls may
+   occasionally lose an update. */
+static struct syscall_stat syscall_stats[SYSCALL_CNT];
 
 void
 syscall_init (void) 
@@ -59,153 +169,310 @@ static void
 syscall_handler (struct intr_frame *f UNUSED) 
 {
   uint32_t* args = ((uint32_t*) f->esp);
+  const struct syscall *sc;
+  uint32_t number;
+  uint64_t start;
+  int i;
+
+  /* The system call number may straddle a page boundary. */
   validate_mem (args);
+  validate_mem ((uint8_t *) (args + 1) - 1);
 
-  /* void exit (int status) */
-  if (args[0] == SYS_EXIT) 
+  number = args[0];
+  if (number >= SYSCALL_CNT || syscalls[number].func == NULL)
+    return;
+  sc = &syscalls[number];
+
+  /* The argument words are contiguous, so checking the last byte
+     covers the only other page they can touch. */
+  if (sc->argc > 0)
+    validate_mem ((uint8_t *) (args + 1 + sc->argc) - 1);
+  for (i = 0; i < sc->argc; i++)
+    if (sc->ptr_args & PTR (i))
+      validate_mem ((const void *) args[i + 1]);
+
+  syscall_stats[number].calls++;
+  start = rdtsc ();
+  if (sc->txn)
     {
-      validate_mem (&args[1]);
-      exit (args[1]);
-    } 
+      journal_begin ();
+      f->eax = sc->func (args + 1);
+      journal_end ();
+    }
+  else
+    f->eax = sc->func (args + 1);
+  syscall_stats[number].cycles += rdtsc () - start;
+}
 
-  /* void halt(void) */
-  else if (args[0] == SYS_HALT) 
-    {
-      halt ();
-    } 
+static uint32_t
+sys_halt (const uint32_t *args UNUSED)
+{
+  halt ();
+  return 0;
+}
 
-  /* pid_t exec (conts char *cmd_line) */
-  else if (args[0] == SYS_EXEC) 
-    {
-      tid_t rtrn = exec (args[1]);
-      f->eax = rtrn;
-    } 
+static uint32_t
+sys_exit (const uint32_t *args)
+{
+  exit (args[0]);
+  NOT_REACHED ();
+}
 
-  /* int wait (pid_t pid) */
-  else if (args[0] == SYS_WAIT) 
-    {
-      int rtrn = wait (args[1]);
-      f->eax = rtrn;
-    } 
+static uint32_t
+sys_exec (const uint32_t *args)
+{
+  char *cmd_line = copy_in_string ((const char *) args[0]);
+  tid_t tid;
+
+  if (cmd_line == NULL)
+    return TID_ERROR;
+  tid = exec (cmd_line);
+  palloc_free_page (cmd_line);
+  return tid;
+}
 
-  /* bool create(const char *file, unsigned initial_size) */
-  else if (args[0] == SYS_CREATE) 
-    {
-      bool rtrn = create (args[1], args[2]);
-      f->eax = rtrn;
-    } 
+static uint32_t
+sys_wait (const uint32_t *args)
+{
+  return wait (args[0]);
+}
 
-  /* bool remove (const char *file) */
-  else if (args[0] == SYS_REMOVE) 
-    {
-      bool rtrn = remove (args[1]);
-      f->eax = rtrn;
-    } 
+static uint32_t
+sys_create (const uint32_t *args)
+{
+  char *file = copy_in_string ((const char *) args[0]);
+  bool success;
 
-  /* int open(const char *file) */
-  else if (args[0] == SYS_OPEN) 
-    {
-      f->eax = open (args[1]);
-    } 
+  if (file == NULL)
+    return false;
+  success = create (file, args[1]);
+  palloc_free_page (file);
+  return success;
+}
 
-  /* int filesize(int fd) */
-  else if (args[0] == SYS_FILESIZE) 
-    {
-      int rtrn = filesize (args[1]);
-      f->eax = rtrn;
-    } 
+static uint32_t
+sys_remove (const uint32_t *args)
+{
+  char *file = copy_in_string ((const char *) args[0]);
+  bool success;
 
-  /* int read(int fd, void* buffer, unsigned size) */
-  else if (args[0] == SYS_READ) 
-    {
-      f->eax = read (args[1], args[2], args[3]);
-    } 
+  if (file == NULL)
+    return false;
+  success = remove (file);
+  palloc_free_page (file);
+  return success;
+}
 
-  /* int write(int fd, void* buffer, unsigned size) */
-  else if (args[0] == SYS_WRITE) 
-    {
-      f->eax = write (args[1], args[2], args[3]);
-    }
+static uint32_t
+sys_open (const uint32_t *args)
+{
+  char *file = copy_in_string ((const char *) args[0]);
+  int fd;
 
-  /* void seek(int fd, unsigned position) */
-  else if (args[0] == SYS_SEEK) 
-    {
-      seek (args[1], args[2]);
-    } 
+  if (file == NULL)
+    return -1;
+  fd = open (file);
+  palloc_free_page (file);
+  return fd;
+}
 
-  /* unsigned tell (int fd) */
-  else if (args[0] == SYS_TELL) 
-    {
-      unsigned rtrn = tell (args[1]);
-      f->eax = rtrn;
-    } 
+static uint32_t
+sys_filesize (const uint32_t *args)
+{
+  return filesize (args[0]);
+}
 
-  /* void close(int fd) */
-  else if (args[0] == SYS_CLOSE) 
-    {
-      close (args[1]);
-    } 
+static uint32_t
+sys_read (const uint32_t *args)
+{
+  return read (args[0], (void *) args[1], args[2]);
+}
 
-  /* int practice(int i) */
-  else if (args[0] == SYS_PRACTICE) 
-    {
-      int rtrn = practice (args[1]);
-      f->eax = rtrn;
-    }
+static uint32_t
+sys_write (const uint32_t *args)
+{
+  return write (args[0], (void *) args[1], args[2]);
+}
 
+static uint32_t
+sys_seek (const uint32_t *args)
+{
+  seek (args[0], args[1]);
+  return 0;
+}
 
-  /* student testing-1 */
-  else if (args[0] == SYS_TEST3) 
-    {
-      reset_cache_count ();
-    }
-  else if (args[0] == SYS_TEST4) 
-    {
-      int rtrn = get_cache_read_count ();
-      f->eax = rtrn;
-    }
-  else if (args[0] == SYS_TEST5) 
-    {
-      int rtrn = get_cache_hit_count ();
-      f->eax = rtrn;
-    }
+static uint32_t
+sys_tell (const uint32_t *args)
+{
+  return tell (args[0]);
+}
 
-  /* student testing-2 */
-  else if (args[0] == SYS_TEST6) 
-    {
-      get_stats ();
-    }
+static uint32_t
+sys_close (const uint32_t *args)
+{
+  close (args[0]);
+  return 0;
+}
 
+static uint32_t
+sys_practice (const uint32_t *args)
+{
+  return practice (args[0]);
+}
 
-  /* bool chdir (const char *dir) */
-  else if (args[0] == SYS_CHDIR)
-    {
-      f->eax = (bool) chdir ((const char *)args[1]);
-    }
+static uint32_t
+sys_reset_cache_count (const uint32_t *args UNUSED)
+{
+  reset_cache_count ();
+  return 0;
+}
 
-  /* bool mkdir (const char *dir) */
-  else if (args[0] == SYS_MKDIR)
-    {
-      f->eax = (bool) mkdir ((const char *)args[1]);
-    }
+static uint32_t
+sys_get_cache_read_count (const uint32_t *args UNUSED)
+{
+  return get_cache_read_count ();
+}
 
-  /* bool readdir (int fd, char *name) */
-  else if (args[0] == SYS_READDIR)
-    {
-      f->eax = (bool) readdir (args[1], (char *) args[2]);
-    }
+static uint32_t
+sys_get_cache_hit_count (const uint32_t *args UNUSED)
+{
+  return get_cache_hit_count ();
+}
 
-  /* bool isdir (int fd) */
-  else if (args[0] == SYS_ISDIR)
-  {
-    f->eax = isdir (args[1]);
-  }
+static uint32_t
+sys_get_stats (const uint32_t *args UNUSED)
+{
+  get_stats ();
+  return 0;
+}
 
-  /* int inumber(int fd) */
-  else if (args[0] == SYS_INUMBER)
-  {
-    f->eax = inumber (args[1]);
-  }
+static uint32_t
+sys_chdir (const uint32_t *args)
+{
+  char *dir = copy_in_string ((const char *) args[0]);
+  bool success;
+
+  if (dir == NULL)
+    return false;
+  success = chdir (dir);
+  palloc_free_page (dir);
+  return success;
+}
+
+static uint32_t
+sys_mkdir (const uint32_t *args)
+{
+  char *dir = copy_in_string ((const char *) args[0]);
+  bool success;
+
+  if (dir == NULL)
+    return false;
+  success = mkdir (dir);
+  palloc_free_page (dir);
+  return success;
+}
+
+static uint32_t
+sys_readdir (const uint32_t *args)
+{
+  return readdir (args[0], (char *) args[1]);
+}
+
+static uint32_t
+sys_isdir (const uint32_t *args)
+{
+  return isdir (args[0]);
+}
+
+static uint32_t
+sys_inumber (const uint32_t *args)
+{
+  return inumber (args[0]);
+}
+
+static uint32_t
+sys_readdir_batch (const uint32_t *args)
+{
+  return readdir_batch (args[0], (struct dirent *) args[1], args[2]);
+}
+
+static uint32_t
+sys_stat (const uint32_t *args)
+{
+  char *file = copy_in_string ((const char *) args[0]);
+  bool success;
+
+  if (file == NULL)
+    return false;
+  success = stat (file, (struct stat *) args[1]);
+  palloc_free_page (file);
+  return success;
+}
+
+static uint32_t
+sys_readv (const uint32_t *args)
+{
+  return readv (args[0], (const struct iovec *) args[1], args[2]);
+}
+
+static uint32_t
+sys_writev (const uint32_t *args)
+{
+  return writev (args[0], (const struct iovec *) args[1], args[2]);
+}
+
+static uint32_t
+sys_pread (const uint32_t *args)
+{
+  return pread (args[0], (void *) args[1], args[2], args[3]);
+}
+
+static uint32_t
+sys_pwrite (const uint32_t *args)
+{
+  return pwrite (args[0], (const void *) args[1], args[2], args[3]);
+}
+
+static uint32_t
+sys_copy_file_range (const uint32_t *args)
+{
+  return copy_file_range (args[0], args[1], args[2]);
+}
+
+static uint32_t
+sys_fallocate (const uint32_t *args)
+{
+  return fallocate (args[0], args[1]);
+}
+
+static uint32_t
+sys_fsync (const uint32_t *args)
+{
+  return fsync (args[0]);
+}
+
+static uint32_t
+sys_fdatasync (const uint32_t *args)
+{
+  return fdatasync (args[0]);
+}
+
+static uint32_t
+sys_get_page_fault_count (const uint32_t *args UNUSED)
+{
+  return get_page_fault_count ();
+}
+
+static uint32_t
+sys_get_syscall_stat (const uint32_t *args)
+{
+  return get_syscall_stat (args[0], (struct syscall_stat *) args[1]);
+}
+
+static uint32_t
+sys_get_cache_stat (const uint32_t *args)
+{
+  return get_cache_stat (args[0], (struct cache_stat *) args[1]);
 }
 
 void
@@ -213,10 +480,10 @@ exit (int status)
 {
   printf ("%s: exit(%d)\n", &thread_current ()->name, status);
   update_wait (status);
-  struct fd_entry* fd_entry = thread_current ()->fd_table[128];
-  struct file* exec_file = fd_entry->fd_pointer;
-  file_allow_write (exec_file);
-  file_close_all (thread_current ()->fd_table);
+  struct file* exec_file = thread_current ()->exec_file;
+  if (exec_file != NULL)
+    file_allow_write (exec_file);
+  /* process_exit() closes the open files, as one transaction. */
   thread_exit ();
 }
 
@@ -235,7 +502,6 @@ wait (tid_t tid)
 tid_t
 exec (const char *cmd_line)
 {
-  validate_mem (cmd_line);
   return process_execute (cmd_line);
 }
 
@@ -249,7 +515,7 @@ halt ()
 unsigned
 tell (int fd)
 {
-  struct fd_entry* fd_entry = thread_current ()->fd_table[fd];
+  struct fd_entry* fd_entry = fd_get (fd);
 
   if (fd_entry == NULL || fd_entry->type != 0) 
     return 0;
@@ -260,8 +526,6 @@ tell (int fd)
 bool
 create (const char* file, unsigned initial_size)
 {
-  validate_mem (file);
- 
   if (file == NULL) 
     return 0;
 
@@ -284,7 +548,7 @@ remove (const char* file)
 void
 seek (int fd, unsigned position)
 {
-  struct fd_entry* fd_entry = thread_current ()->fd_table[fd];
+  struct fd_entry* fd_entry = fd_get (fd);
 
   if (fd_entry == NULL || fd_entry->type != 0)  
     return;
@@ -295,7 +559,7 @@ seek (int fd, unsigned position)
 int 
 filesize (int fd)
 {
-  struct fd_entry* fd_entry = thread_current ()->fd_table[fd];
+  struct fd_entry* fd_entry = fd_get (fd);
 
   if (fd_entry == NULL || fd_entry->type != 0)
     return -1;
@@ -309,8 +573,6 @@ open (const char *file)
   if (file == NULL) 
     return -1;
 
-  validate_mem (file);
-
   // struct file* new_file = filesys_open (file);
 
   // if (new_file == NULL) 
@@ -361,11 +623,14 @@ open (const char *file)
   dir_close (dir);
 
   struct fd_entry* fd_entry;
-  fd_entry = malloc (sizeof (struct fd_entry));
 
   if (inode == NULL)
     return -1;
 
+  fd_entry = fd_entry_alloc ();
+  if (fd_entry == NULL)
+    return -1;
+
   /* inode of a DIR */
   if (inode_isdir(inode)) 
     {
@@ -379,96 +644,300 @@ open (const char *file)
     }
   
   if (fd_entry->fd_pointer == NULL) 
-    return -1;
+    {
+      fd_entry_free (fd_entry);
+      return -1;
+    }
 
-  int new_fd = first_avail_fd (thread_current ()->fd_table);
+  int new_fd = fd_install (fd_entry);
 
   if (new_fd == -1) 
-    return -1;
-
-  thread_current ()->fd_table[new_fd] = fd_entry;
+    {
+      if (fd_entry->type)
+        dir_close (fd_entry->fd_pointer);
+      else
+        file_close (fd_entry->fd_pointer);
+      fd_entry_free (fd_entry);
+      return -1;
+    }
 
   return new_fd; 
   
 }
 
+/* Reads SIZE bytes into user BUFFER one page-sized chunk at a
+   time, so that each user page is validated only once. */
 int 
 read (int fd, void* buffer, unsigned size)
 {
-  validate_mem (buffer);
+  uint8_t *ubuf = buffer;
 
   if (fd == 0) /* Reading from STDIN */
     {
-      uint8_t* buf = (uint8_t *) buffer;
-      unsigned i;
+      unsigned bytes_read = 0;
 
-      for (i = 0; i < size; i++)
+      while (bytes_read < size)
         {
-          buf[i] = input_getc ();
+          unsigned chunk = PGSIZE - pg_ofs (ubuf);
+          uint8_t *kbuf = user_to_kernel (ubuf, true);
+          unsigned i;
+
+          if (chunk > size - bytes_read)
+            chunk = size - bytes_read;
+          for (i = 0; i < chunk; i++)
+            kbuf[i] = input_getc ();
+          bytes_read += chunk;
+          ubuf += chunk;
         }
-        
-      return size; 
-    } 
-
-  if (fd == 1 || fd < 0 || fd > 127) /* Attempting to Read from STDOUT */  
-    return -1;
-
-  if (fd >= 2) /* Reading from open file */
-    {
-      struct fd_entry* fd_entry = thread_current ()->fd_table[fd];
-      
-      if (fd_entry == NULL || fd_entry->type != 0)
-        return -1;
+      return bytes_read;
+    }
 
-      /* check if data is in cache here */
+  struct file *file = fd_file (fd);
+  off_t bytes_read;
 
-      int output = file_read (fd_entry->fd_pointer, buffer, size); 
-      return output;
-    }
+  if (file == NULL)
+    return -1;
 
-  /* fd is not stdin or valid fd, or mem is not valid */
-  return -1;
+  bytes_read = file_user_io (file, ubuf, size, file_tell (file), false);
+  file_seek (file, file_tell (file) + bytes_read);
+  return bytes_read;
 }
 
+/* Writes SIZE bytes from user BUFFER one page-sized chunk at a
+   time, so that each user page is validated only once. */
 int 
 write (int fd, void* buffer, unsigned size)
 {
-  validate_mem (buffer);
+  uint8_t *ubuf = buffer;
 
   if (fd == 1) /* Writing to STOUT */
     {
-      putbuf (buffer, size);
-      return size; 
-    } 
+      unsigned bytes_written = 0;
 
-  if (fd <= 0 || fd > 127) /* Attempting to Write to STDIN */  
+      while (bytes_written < size)
+        {
+          unsigned chunk = PGSIZE - pg_ofs (ubuf);
+          const char *kbuf = (const char *) user_to_kernel (ubuf, false);
+
+          if (chunk > size - bytes_written)
+            chunk = size - bytes_written;
+          putbuf (kbuf, chunk);
+          bytes_written += chunk;
+          ubuf += chunk;
+        }
+      return bytes_written;
+    }
+
+  struct file *file = fd_file (fd);
+  off_t bytes_written;
+
+  if (file == NULL)
     return -1;
 
-  if (fd >= 2) /* Writing to open file */
-    {
-      /* get file from data structure */
-      struct fd_entry* fd_entry = thread_current ()->fd_table[fd];
+  journal_begin ();
+  bytes_written = file_user_io (file, ubuf, size, file_tell (file), true);
+  file_seek (file, file_tell (file) + bytes_written);
+  journal_end ();
+  return bytes_written;
+}
 
-      /* check if file is null */
-      if (fd_entry == NULL || fd_entry->type != 0)
-        return -1;
+/* Maximum number of buffers in a readv() or writev() vector. */
+#define IOV_MAX 1024
 
-      /* check if data is in cache here */
-      int output = file_write (fd_entry->fd_pointer, buffer, size);
+/* Number of iovecs copied from user memory at a time. */
+#define IOV_BATCH 16
 
-      return output;
+/* Reads or writes, according to IS_WRITE, the IOVCNT buffers
+   described by user array IOV in order, as if by one read() or
+   write() per buffer but with a single system call.  Stops at
+   the first short transfer.  Returns the total number of bytes
+   transferred, or -1 if the first transfer fails. */
+static int
+iov_io (int fd, const struct iovec *iov, int iovcnt, bool is_write)
+{
+  struct iovec batch[IOV_BATCH];
+  int total = 0;
+  int i;
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX)
+    return -1;
+
+  for (i = 0; i < iovcnt; i++)
+    {
+      struct iovec *v = &batch[i % IOV_BATCH];
+      int n;
+
+      if (i % IOV_BATCH == 0)
+        copy_from_user (batch, iov + i,
+                        (iovcnt - i < IOV_BATCH ? iovcnt - i : IOV_BATCH)
+                        * sizeof *batch);
+
+      n = (is_write ? write (fd, v->iov_base, v->iov_len)
+                    : read (fd, v->iov_base, v->iov_len));
+      if (n < 0)
+        return i == 0 ? -1 : total;
+      total += n;
+      if ((size_t) n < v->iov_len)
+        break;
     }
+  return total;
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return iov_io (fd, iov, iovcnt, false);
+}
 
-  return -1;
+/* Writes to a file are one transaction, as for write(); the
+   console and bad fds need none. */
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  int total;
+
+  if (fd_file (fd) == NULL)
+    return iov_io (fd, iov, iovcnt, true);
+
+  journal_begin ();
+  total = iov_io (fd, iov, iovcnt, true);
+  journal_end ();
+  return total;
+}
+
+/* Reads SIZE bytes from file FD at OFFSET into user BUFFER
+   without using or changing the file position. */
+int
+pread (int fd, void *buffer, unsigned size, off_t offset)
+{
+  struct file *file = fd_file (fd);
+
+  if (file == NULL || offset < 0)
+    return -1;
+  return file_user_io (file, buffer, size, offset, false);
+}
+
+/* Writes SIZE bytes from user BUFFER to file FD at OFFSET
+   without using or changing the file position. */
+int
+pwrite (int fd, const void *buffer, unsigned size, off_t offset)
+{
+  struct file *file = fd_file (fd);
+
+  if (file == NULL || offset < 0)
+    return -1;
+  return file_user_io (file, (uint8_t *) buffer, size, offset, true);
+}
+
+/* Copies SIZE bytes from file FD_IN to file FD_OUT, starting at
+   and advancing each file's position, entirely inside the
+   kernel.  Returns the number of bytes copied, or -1 if either fd
+   is not an open file or both name the same file and the ranges
+   overlap. */
+int
+copy_file_range (int fd_in, int fd_out, unsigned size)
+{
+  struct file *in = fd_file (fd_in);
+  struct file *out = fd_file (fd_out);
+
+  if (in == NULL || out == NULL || (off_t) size < 0)
+    return -1;
+  return file_copy (in, out, size);
+}
+
+/* Allocates disk sectors for the first LENGTH bytes of file FD,
+   extending it to LENGTH bytes if it is shorter, so that later
+   writes there need not allocate and are laid out together.
+   Returns 0 if successful, -1 if FD is not an open file, writes
+   to it are denied, or the disk is full. */
+int
+fallocate (int fd, unsigned length)
+{
+  struct file *file = fd_file (fd);
+
+  if (file == NULL || !file_allocate (file, length))
+    return -1;
+  return 0;
+}
+
+/* Writes file FD's dirty data and its inode to disk, returning
+   once they are durable.  Returns 0 if successful, -1 if FD is
+   not an open file. */
+int
+fsync (int fd)
+{
+  struct file *file = fd_file (fd);
+
+  if (file == NULL)
+    return -1;
+  file_sync (file, false);
+  return 0;
+}
+
+/* Like fsync(), but skips writing the inode unless the file has
+   grown, since only its length and block map are needed to read
+   the data back. */
+int
+fdatasync (int fd)
+{
+  struct file *file = fd_file (fd);
+
+  if (file == NULL)
+    return -1;
+  file_sync (file, true);
+  return 0;
+}
+
+/* Returns the open file for FD, or a null pointer if FD is not
+   open or is a directory. */
+static struct file *
+fd_file (int fd)
+{
+  struct fd_entry *fd_entry = fd_get (fd);
+
+  if (fd_entry == NULL || fd_entry->type != 0)
+    return NULL;
+  return fd_entry->fd_pointer;
+}
+
+/* Transfers SIZE bytes between user buffer UBUF and FILE starting
+   at OFFSET, reading from the file if IS_WRITE is false and writing
+   to it otherwise.  Each user page is validated once and handed
+   to file_read_at() or file_write_at() whole.  Returns the number
+   of bytes transferred, which is short only at end of file or if
+   writes are denied. */
+static off_t
+file_user_io (struct file *file, uint8_t *ubuf, off_t size, off_t offset,
+              bool is_write)
+{
+  off_t done = 0;
+
+  while (done < size)
+    {
+      off_t chunk = PGSIZE - pg_ofs (ubuf);
+      uint8_t *kbuf = user_to_kernel (ubuf, !is_write);
+      off_t n;
+
+      if (chunk > size - done)
+        chunk = size - done;
+
+      n = (is_write ? file_write_at (file, kbuf, chunk, offset + done)
+                    : file_read_at (file, kbuf, chunk, offset + done));
+      done += n;
+      if (n < chunk)
+        break;
+      ubuf += chunk;
+    }
+  return done;
 }
 
 void
 close (int fd)
 {
-  if (fd < 2 || fd > 127) 
+  if (fd < 2) 
     return;
 
-  struct fd_entry* fd_entry = thread_current ()->fd_table[fd];
+  struct fd_entry* fd_entry = fd_get (fd);
 
 
   if (fd_entry == NULL || fd_entry->type != 0)
@@ -484,8 +953,7 @@ close (int fd)
 
   /* Removes entry */
   thread_current()->cwd = dir_open_root();
-  free (thread_current ()->fd_table[fd]);
-  thread_current ()->fd_table[fd] = NULL;
+  fd_entry_free (fd_remove (fd));
 }
 
 
@@ -516,13 +984,131 @@ get_stats()
   block_print_stats ();
 }
 
+/* Returns the number of page faults taken so far, system-wide. */
+int
+get_page_fault_count ()
+{
+  return exception_page_fault_cnt ();
+}
+
+/* Copies the statistics for system call NUMBER into STAT.
+   Returns false if there is no such system call. */
+bool
+get_syscall_stat (int number, struct syscall_stat *stat)
+{
+  if (number < 0 || (size_t) number >= SYSCALL_CNT
+      || syscalls[number].func == NULL)
+    return false;
+
+  copy_to_user (stat, &syscall_stats[number], sizeof *stat);
+  return true;
+}
+
+/* Copies the buffer cache statistics of the file or directory
+   open as FD into STAT, or those of the calling process if FD is
+   CACHE_STAT_SELF.  Returns false if FD is not open. */
+bool
+get_cache_stat (int fd, struct cache_stat *stat)
+{
+  struct fd_entry *fd_entry;
+  struct inode *inode;
+  const struct cache_stat *file_stat;
+  struct cache_stat kstat;
+
+  if (fd == CACHE_STAT_SELF)
+    {
+      copy_to_user (stat, &thread_current ()->cache_stat, sizeof *stat);
+      return true;
+    }
+
+  fd_entry = fd_get (fd);
+  if (fd_entry == NULL)
+    return false;
+  if (fd_entry->type)
+    inode = dir_get_inode (fd_entry->fd_pointer);
+  else
+    inode = file_get_inode (fd_entry->fd_pointer);
+  file_stat = inode_cache_stat (inode);
+  if (file_stat != NULL)
+    kstat = *file_stat;
+  else
+    memset (&kstat, 0, sizeof kstat);
+  copy_to_user (stat, &kstat, sizeof kstat);
+  return true;
+}
+
 
 
 bool 
 readdir (int fd, char *name)
 {
-  struct fd_entry* fd_entry = thread_current ()->fd_table[fd];
-  return dir_readdir(fd_entry->fd_pointer, name);
+  struct fd_entry* fd_entry = fd_get (fd);
+  char kname[NAME_MAX + 1];
+
+  if (!dir_readdir (fd_entry->fd_pointer, kname))
+    return false;
+  copy_to_user (name, kname, strlen (kname) + 1);
+  return true;
+}
+
+/* Reads as many entries of directory FD as fit in the SIZE bytes
+   of user buffer ENTS, starting where the last read left off.
+   Entries are gathered in the kernel a batch at a time and
+   copied out with one copy per batch.  Returns the number of
+   entries read, 0 at the end of the directory, or -1 if FD is
+   not an open directory. */
+int
+readdir_batch (int fd, struct dirent *ents, unsigned size)
+{
+  struct fd_entry *fd_entry = fd_get (fd);
+  struct dirent kents[16];
+  size_t cnt = size / sizeof *ents;
+  size_t done = 0;
+
+  if (fd_entry == NULL || fd_entry->type != 1)
+    return -1;
+  while (done < cnt)
+    {
+      size_t n = cnt - done;
+      if (n > sizeof kents / sizeof *kents)
+        n = sizeof kents / sizeof *kents;
+
+      n = dir_readdir_batch (fd_entry->fd_pointer, kents, n);
+      if (n == 0)
+        break;
+      copy_to_user (ents + done, kents, n * sizeof *kents);
+      done += n;
+    }
+  return done;
+}
+
+/* Stores the attributes of FILE into user buffer ST.  FILE's
+   inode is found by its directory entry and read in place, so,
+   unlike open(), filesize() and close(), no inode is opened for
+   it and no fd is spent.  Returns true if successful, false if
+   FILE does not exist. */
+bool
+stat (const char *file, struct stat *st)
+{
+  char name[NAME_MAX + 1];
+  struct dir *dir;
+  struct stat kst;
+  bool success;
+
+  if (file[0] == '\0')
+    return false;
+  dir = walk_path (file, name);
+  if (dir == NULL)
+    return false;
+  if (name[0] == '\0')
+    success = inode_stat (inode_get_inumber (dir_get_inode (dir)), &kst);
+  else
+    success = dir_stat (dir, name, &kst);
+  dir_close (dir);
+
+  if (success)
+    copy_to_user (st, &kst, sizeof kst);
+  return success;
 }
 
 bool
@@ -534,7 +1120,8 @@ mkdir (const char *dir)
 
   //lock_acquire (&io_lock);
 
-  bool output = filesys_create (dir, BLOCK_SECTOR_SIZE, 1);
+  /* Starts empty, and so inline; dir_add() grows it. */
+  bool output = filesys_create (dir, 0, 1);
 
   //lock_release (&io_lock);
 
@@ -563,13 +1150,13 @@ chdir (const char *dir)
 bool
 isdir (int fd)
 {
-  return thread_current()->fd_table[fd]->type;
+  return fd_get (fd)->type;
 }
 
 int 
 inumber(int fd)
 {
-  struct fd_entry *fd_entry = thread_current()->fd_table[fd];
+  struct fd_entry *fd_entry = fd_get (fd);
   
   if (fd_entry->type)
     return (int)inode_get_inumber(dir_get_inode((struct dir *) (fd_entry->fd_pointer)));
@@ -587,17 +1174,174 @@ inumber(int fd)
 void
 validate_mem (const void *uaddr)
 {
-  /* Cases 1 and 2 */
-  if (uaddr == NULL || !(is_user_vaddr (uaddr)))
+  /* Case 1; user_to_kernel() handles the rest. */
+  if (uaddr == NULL)
     exit (-1); 
 
-  uint32_t* pd = thread_current ()->pagedir;
+  user_to_kernel (uaddr, false);
+}
 
-  void* kaddr = pagedir_get_page (pd, pg_round_down (uaddr));
+/* Returns the kernel virtual address that user address UADDR
+   maps to, bringing its page in first under VM.  Exits with -1
+   if UADDR is not a mapped user address, or if WRITE is true and
+   its page is read-only. */
+static uint8_t *
+user_to_kernel (const void *uaddr, bool write)
+{
+  uint32_t *pd = thread_current ()->pagedir;
+  uint8_t *kaddr;
 
-  /* Cases 3 and 4 */
-  if ((kaddr == NULL) || !(is_kernel_vaddr (kaddr)))
+  if (!is_user_vaddr (uaddr))
     exit (-1);
 
-  return;
+  kaddr = pagedir_get_page (pd, uaddr);
+#ifdef VM
+  /* Page may not have been demand-loaded yet. */
+  if (kaddr == NULL && page_fault_in (uaddr))
+    kaddr = pagedir_get_page (pd, uaddr);
+#endif
+
+  if (kaddr == NULL || (write && !pagedir_is_writable (pd, uaddr)))
+    exit (-1);
+  return kaddr;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel buffer DST.
+   Each user page is looked up once and copied with a single
+   memcpy().  Exits with -1 if any source byte is not mapped. */
+void
+copy_from_user (void *dst_, const void *usrc_, size_t size)
+{
+  uint8_t *dst = dst_;
+  const uint8_t *usrc = usrc_;
+
+  while (size > 0)
+    {
+      size_t chunk = PGSIZE - pg_ofs (usrc);
+      if (chunk > size)
+        chunk = size;
+
+      memcpy (dst, user_to_kernel (usrc, false), chunk);
+      dst += chunk;
+      usrc += chunk;
+      size -= chunk;
+    }
+}
+
+/* Copies SIZE bytes from kernel buffer SRC to user address UDST,
+   one page at a time.  Exits with -1 if any destination byte is
+   not mapped writable. */
+void
+copy_to_user (void *udst_, const void *src_, size_t size)
+{
+  uint8_t *udst = udst_;
+  const uint8_t *src = src_;
+
+  while (size > 0)
+    {
+      size_t chunk = PGSIZE - pg_ofs (udst);
+      if (chunk > size)
+        chunk = size;
+
+      memcpy (user_to_kernel (udst, true), src, chunk);
+      udst += chunk;
+      src += chunk;
+      size -= chunk;
+    }
+}
+
+/* Copies the null-terminated string at user address USRC into
+   DST, which has room for SIZE bytes, looking up each user page
+   once.  DST is always null-terminated if SIZE is nonzero.
+   Returns the length of the copied string; a return value of
+   SIZE or more means the string was truncated.  Exits with -1 if
+   the string runs into unmapped memory before it ends. */
+size_t
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  size_t length = 0;
+
+  if (size == 0)
+    return 0;
+
+  for (;;)
+    {
+      size_t chunk = PGSIZE - pg_ofs (usrc);
+      const char *ksrc = (const char *) user_to_kernel (usrc, false);
+      size_t i;
+
+      for (i = 0; i < chunk; i++, length++)
+        {
+          if (ksrc[i] == '\0' || length == size - 1)
+            {
+              dst[length] = '\0';
+              return ksrc[i] == '\0' ? length : size;
+            }
+          dst[length] = ksrc[i];
+        }
+      usrc += chunk;
+    }
+}
+
+/* Returns a copy of user string USTR in a newly allocated page,
+   or a null pointer if USTR does not fit in a page or no page
+   is available.  The caller must free the page with
+   palloc_free_page(). */
+static char *
+copy_in_string (const char *ustr)
+{
+  char *kstr = palloc_get_page (0);
+
+  if (kstr == NULL)
+    return NULL;
+  if (strncpy_from_user (kstr, ustr, PGSIZE) >= PGSIZE)
+    {
+      palloc_free_page (kstr);
+      return NULL;
+    }
+  return kstr;
+}
+
+/* Walks PATH, absolute or relative to the current directory, to
+   the directory that holds its last component, stores that
+   component in NAME, and returns the directory, which the caller
+   must close.  NAME is empty if PATH names the root directory.
+   Returns a null pointer if a directory along the way does not
+   exist or a component is too long. */
+static struct dir *
+walk_path (const char *path, char name[NAME_MAX + 1])
+{
+  char *rest = (char *) path;
+  char next[NAME_MAX + 1];
+  struct dir *dir;
+  int result;
+
+  if (path[0] == '/')
+    dir = dir_open_root ();
+  else
+    dir = dir_reopen (thread_current ()->cwd);
+  name[0] = '\0';
+  result = dir != NULL ? get_next_part (name, &rest) : -1;
+  while (result > 0 && (result = get_next_part (next, &rest)) > 0)
+    {
+      struct inode *inode;
+
+      if (!dir_lookup (dir, name, &inode) || !inode_isdir (inode))
+        {
+          inode_close (inode);
+          result = -1;
+          break;
+        }
+      dir_close (dir);
+      dir = dir_open (inode);
+      if (dir == NULL)
+        return NULL;
+      strlcpy (name, next, NAME_MAX + 1);
+    }
+  if (result < 0)
+    {
+      dir_close (dir);
+      return NULL;
+    }
+  return dir;
 }
@@ -1,9 +1,14 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stddef.h>
+
 void syscall_init (void);
 
 /* Added by Group 51 */
 void validate_mem (const void *uaddr);
+void copy_from_user (void *dst, const void *usrc, size_t size);
+void copy_to_user (void *udst, const void *src, size_t size);
+size_t strncpy_from_user (char *dst, const char *usrc, size_t size);
 
 #endif /* userprog/syscall.h */
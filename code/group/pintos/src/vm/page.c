@@ -0,0 +1,182 @@
+#include "vm/page.h"
+#include <debug.h>
+#include <stdio.h>
+#include <string.h>
+#include "filesys/file.h"
+#include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/thread.h"
+#include "threads/vaddr.h"
+#include "userprog/pagedir.h"
+
+/* Number of pages mapped by fault-around, i.e. pages that were
+   brought in without taking a page fault of their own. */
+static long long fault_around_cnt;
+
+static struct segment *segment_lookup (struct thread *, const uint8_t *upage);
+static bool page_is_cached (const struct segment *, size_t page_idx);
+static bool load_page (struct segment *, size_t page_idx);
+
+/* Records that the READ_BYTES + ZERO_BYTES bytes of user memory
+   starting at UPAGE are backed by FILE at offset OFS, followed by
+   zeros, without reading anything yet.  Pages are brought in by
+   page_fault_in() the first time they are touched.
+   Returns true if successful, false on memory allocation failure. */
+bool
+page_add_segment (struct file *file, off_t ofs, uint8_t *upage,
+                  uint32_t read_bytes, uint32_t zero_bytes, bool writable)
+{
+  struct segment *s;
+
+  ASSERT ((read_bytes + zero_bytes) % PGSIZE == 0);
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (ofs % PGSIZE == 0);
+
+  s = malloc (sizeof *s);
+  if (s == NULL)
+    return false;
+
+  s->file = file;
+  s->ofs = ofs;
+  s->upage = upage;
+  s->read_bytes = read_bytes;
+  s->zero_bytes = zero_bytes;
+  s->writable = writable;
+  list_push_back (&thread_current ()->segments, &s->elem);
+  return true;
+}
+
+/* Brings in the page containing user address UADDR if it belongs
+   to one of the current process's segments and is not mapped yet.
+   Also maps the other unmapped pages of the same segment that lie
+   in the FAULT_AROUND_PAGES-aligned window around UADDR, as long
+   as their data is already in the buffer cache, so that touching
+   them later does not cost another fault.
+   Returns true if the page is now present, false otherwise. */
+bool
+page_fault_in (const void *uaddr)
+{
+  struct thread *t = thread_current ();
+  uint8_t *upage = pg_round_down (uaddr);
+  struct segment *s;
+  size_t page_idx, page_cnt, first, i;
+
+  if (t->pagedir == NULL || pagedir_get_page (t->pagedir, upage) != NULL)
+    return false;
+
+  s = segment_lookup (t, upage);
+  if (s == NULL)
+    return false;
+
+  page_idx = (upage - s->upage) / PGSIZE;
+  if (!load_page (s, page_idx))
+    return false;
+
+  /* Fault-around. */
+  page_cnt = (s->read_bytes + s->zero_bytes) / PGSIZE;
+  first = page_idx - page_idx % FAULT_AROUND_PAGES;
+  for (i = first; i < first + FAULT_AROUND_PAGES && i < page_cnt; i++)
+    if (i != page_idx
+        && pagedir_get_page (t->pagedir, s->upage + i * PGSIZE) == NULL
+        && page_is_cached (s, i)
+        && load_page (s, i))
+      fault_around_cnt++;
+
+  return true;
+}
+
+/* Frees the current process's segment list.  The pages already
+   loaded belong to the page directory and are freed with it. */
+void
+page_destroy_segments (void)
+{
+  struct list *segments = &thread_current ()->segments;
+
+  while (!list_empty (segments))
+    {
+      struct list_elem *e = list_pop_front (segments);
+      free (list_entry (e, struct segment, elem));
+    }
+}
+
+/* Prints paging statistics. */
+void
+page_print_stats (void)
+{
+  printf ("Paging: %lld pages mapped by fault-around\n", fault_around_cnt);
+}
+
+/* Returns the segment of T that contains UPAGE, or a null pointer
+   if there is none. */
+static struct segment *
+segment_lookup (struct thread *t, const uint8_t *upage)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&t->segments); e != list_end (&t->segments);
+       e = list_next (e))
+    {
+      struct segment *s = list_entry (e, struct segment, elem);
+      if (upage >= s->upage
+          && upage < s->upage + s->read_bytes + s->zero_bytes)
+        return s;
+    }
+  return NULL;
+}
+
+/* Returns the number of bytes of page PAGE_IDX of S that come
+   from the file.  The rest of the page is zeroed. */
+static size_t
+page_read_bytes (const struct segment *s, size_t page_idx)
+{
+  size_t ofs = page_idx * PGSIZE;
+
+  if (s->read_bytes <= ofs)
+    return 0;
+  return s->read_bytes - ofs < PGSIZE ? s->read_bytes - ofs : PGSIZE;
+}
+
+/* Returns true if page PAGE_IDX of S can be filled without disk
+   I/O, that is, it is all zeros or its data is in the buffer
+   cache. */
+static bool
+page_is_cached (const struct segment *s, size_t page_idx)
+{
+  size_t read_bytes = page_read_bytes (s, page_idx);
+
+  return (read_bytes == 0
+          || inode_is_cached (file_get_inode (s->file),
+                              s->ofs + page_idx * PGSIZE, read_bytes));
+}
+
+/* Reads page PAGE_IDX of S into a new user frame and maps it.
+   Returns true if successful, false if memory allocation fails
+   or the file is shorter than the segment claims. */
+static bool
+load_page (struct segment *s, size_t page_idx)
+{
+  struct thread *t = thread_current ();
+  size_t read_bytes = page_read_bytes (s, page_idx);
+  uint8_t *kpage;
+
+  kpage = palloc_get_page (PAL_USER);
+  if (kpage == NULL)
+    return false;
+
+  if (file_read_at (s->file, kpage, read_bytes, s->ofs + page_idx * PGSIZE)
+      != (off_t) read_bytes)
+    {
+      palloc_free_page (kpage);
+      return false;
+    }
+  memset (kpage + read_bytes, 0, PGSIZE - read_bytes);
+
+  if (!pagedir_set_page (t->pagedir, s->upage + page_idx * PGSIZE, kpage,
+                         s->writable))
+    {
+      palloc_free_page (kpage);
+      return false;
+    }
+  return true;
+}
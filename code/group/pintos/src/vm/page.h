@@ -0,0 +1,34 @@
+#ifndef VM_PAGE_H
+#define VM_PAGE_H
+
+#include <list.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "filesys/off_t.h"
+
+struct file;
+
+/* Size of the aligned window of pages, including the faulting
+   one, that a single page fault may map from a segment. */
+#define FAULT_AROUND_PAGES 8
+
+/* An executable segment whose pages are loaded on demand. */
+struct segment
+  {
+    struct list_elem elem;              /* Element in thread's segment list. */
+    struct file *file;                  /* Executable backing the segment. */
+    off_t ofs;                          /* File offset of the first page. */
+    uint8_t *upage;                     /* First user page. */
+    uint32_t read_bytes;                /* Bytes to read from FILE. */
+    uint32_t zero_bytes;                /* Bytes to zero after READ_BYTES. */
+    bool writable;                      /* Writable by the user process? */
+  };
+
+bool page_add_segment (struct file *file, off_t ofs, uint8_t *upage,
+                       uint32_t read_bytes, uint32_t zero_bytes,
+                       bool writable);
+bool page_fault_in (const void *uaddr);
+void page_destroy_segments (void);
+void page_print_stats (void);
+
+#endif /* vm/page.h */